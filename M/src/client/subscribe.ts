@@ -4,7 +4,8 @@ import Models = require("./models");
 
 class KSocket extends WebSocket {
   constructor() {
-    super(location.origin.replace('http', 'ws'));
+    super(location.origin.replace('http', 'ws') + '/?msgpack');
+    this.binaryType = 'arraybuffer';
     for (const ev in events) events[ev].forEach(cb => this.addEventListener(ev, cb));
     this.addEventListener('close', () => {
       setTimeout(() => { socket = new KSocket(); }, 5000);
@@ -20,6 +21,74 @@ class KSocket extends WebSocket {
 var events = {};
 var socket = new KSocket();
 
+var unpack = (b: Uint8Array, i: number[]) => {
+  const view = new DataView(b.buffer, b.byteOffset, b.byteLength);
+  const str = (n: number) => {
+    let s = '';
+    for (const end = i[0] + n; i[0] < end; i[0]++) s += String.fromCharCode(b[i[0]]);
+    return decodeURIComponent(escape(s));
+  };
+  const arr = (n: number) => {
+    const a = [];
+    while (n--) a.push(unpack(b, i));
+    return a;
+  };
+  const obj = (n: number) => {
+    const o = {};
+    while (n--) { const k = unpack(b, i); o[k] = unpack(b, i); }
+    return o;
+  };
+  const t = b[i[0]++];
+  let k;
+  if (t < 0x80) return t;
+  if (t < 0x90) return obj(t & 0x0f);
+  if (t < 0xa0) return arr(t & 0x0f);
+  if (t < 0xc0) return str(t & 0x1f);
+  if (t >= 0xe0) return t - 0x100;
+  switch (t) {
+    case 0xc0: return null;
+    case 0xc2: return false;
+    case 0xc3: return true;
+    case 0xca: k = view.getFloat32(i[0]); i[0] += 4; return k;
+    case 0xcb: k = view.getFloat64(i[0]); i[0] += 8; return k;
+    case 0xcc: return b[i[0]++];
+    case 0xcd: k = view.getUint16(i[0]); i[0] += 2; return k;
+    case 0xce: k = view.getUint32(i[0]); i[0] += 4; return k;
+    case 0xcf: k = view.getUint32(i[0]) * 4294967296 + view.getUint32(i[0] + 4); i[0] += 8; return k;
+    case 0xd0: return view.getInt8(i[0]++);
+    case 0xd1: k = view.getInt16(i[0]); i[0] += 2; return k;
+    case 0xd2: k = view.getInt32(i[0]); i[0] += 4; return k;
+    case 0xd3: k = view.getInt32(i[0]) * 4294967296 + view.getUint32(i[0] + 4); i[0] += 8; return k;
+    case 0xd9: return str(b[i[0]++]);
+    case 0xda: k = view.getUint16(i[0]); i[0] += 2; return str(k);
+    case 0xdb: k = view.getUint32(i[0]); i[0] += 4; return str(k);
+    case 0xdc: k = view.getUint16(i[0]); i[0] += 2; return arr(k);
+    case 0xdd: k = view.getUint32(i[0]); i[0] += 4; return arr(k);
+    case 0xde: k = view.getUint16(i[0]); i[0] += 2; return obj(k);
+    case 0xdf: k = view.getUint32(i[0]); i[0] += 4; return obj(k);
+    case 0xc4: case 0xc5: case 0xc6:
+    case 0xc7: case 0xc8: case 0xc9:
+    case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+      throw new Error("msgpack bin/ext type " + t + " is never sent by the server");
+  }
+  throw new Error("unsupported msgpack type " + t);
+};
+
+var decode = (data: string | ArrayBuffer): [string, any] => {
+  if (typeof data == 'string') return [data.substr(0,2), JSON.parse(data.substr(2))];
+  const b = new Uint8Array(data);
+  return [String.fromCharCode(b[0], b[1]), b.length > 2 ? unpack(b, [2]) : null];
+};
+
+var bookRate = 100; // ms between book deltas, asked to the server when subscribing to MarketData
+
+var merge = (levels: Models.MarketSide[], update: Models.MarketSide[], sort: (a: number, b: number) => number): Models.MarketSide[] => {
+  const k = {};
+  levels.forEach(x => k[x.price] = x.size);
+  update.forEach(x => { if (x.size) k[x.price] = x.size; else delete k[x.price]; });
+  return Object.keys(k).map(x => new Models.MarketSide(+x, k[x])).sort((a, b) => sort(a.price, b.price));
+};
+
 export interface ISubscribe<T> {
   registerSubscriber: (incrementalHandler: (msg: T) => void) => ISubscribe<T>;
   registerConnectHandler: (handler: () => void) => ISubscribe<T>;
@@ -31,6 +100,7 @@ export class Subscriber<T> extends Observable<T> implements ISubscribe<T> {
   private _connectHandler: () => void = null;
   private _disconnectHandler: () => void = null;
   private _incrementalHandler: boolean;
+  private _book: { seq: number, bids: Models.MarketSide[], asks: Models.MarketSide[] } = null;
 
   constructor(
     private _topic: string
@@ -41,9 +111,11 @@ export class Subscriber<T> extends Observable<T> implements ISubscribe<T> {
       socket.setEventListener('open', this.onConnect);
       socket.setEventListener('close', this.onDisconnect);
       socket.setEventListener('message', (msg) => {
-        const topic = msg.data.substr(0,2);
-        const data = JSON.parse(msg.data.substr(2));
-        if (Models.Prefixes.MESSAGE+this._topic == topic) observer.next(data);
+        let [topic, data] = decode(msg.data);
+        if (Models.Prefixes.MESSAGE+this._topic == topic) {
+          if (this._topic == Models.Topics.MarketData) data = this.onBook(data);
+          if (data !== null) observer.next(data);
+        }
         else if (Models.Prefixes.SNAPSHOT+this._topic == topic)
           data.forEach(item => setTimeout(() => observer.next(item), 0));
       });
@@ -60,7 +132,24 @@ export class Subscriber<T> extends Observable<T> implements ISubscribe<T> {
       if (this._connectHandler !== null)
           this._connectHandler();
 
-      socket.send(Models.Prefixes.SNAPSHOT + this._topic);
+      this._book = null;
+      socket.send(Models.Prefixes.SNAPSHOT + this._topic + (this._topic == Models.Topics.MarketData ? JSON.stringify({rate: bookRate}) : ''));
+  };
+
+  private onBook = (data): Models.Market => {
+    if (data === null || typeof data.seq == 'undefined') return data;
+    if (data.delta && (this._book === null || data.seq != this._book.seq + 1)) {
+      if (this._book !== null) this.onConnect();
+      return null;
+    }
+    if (!data.delta) this._book = { seq: data.seq, bids: [], asks: [] };
+    this._book.seq = data.seq;
+    this._book.bids = merge(this._book.bids, data.bids, (a, b) => b - a);
+    this._book.asks = merge(this._book.asks, data.asks, (a, b) => a - b);
+    return new Models.Market(
+      this._book.bids.map(x => new Models.MarketSide(x.price, x.size)),
+      this._book.asks.map(x => new Models.MarketSide(x.price, x.size))
+    );
   };
 
   private onDisconnect = () => {
@@ -0,0 +1,84 @@
+#ifndef K_K_H_
+#define K_K_H_
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+#include <locale>
+#include <time.h>
+#include <math.h>
+#include <getopt.h>
+#include <signal.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <bitset>
+#include <random>
+#include <functional>
+#include <memory>
+
+#include "sqlite3.h"
+#include "uWS/uWS.h"
+#include "curl/curl.h"
+#include "openssl/hmac.h"
+#include "openssl/sha.h"
+#include "openssl/md5.h"
+#include "ncurses/ncurses.h"
+#include "quickfix/Application.h"
+#include "quickfix/SocketInitiator.h"
+#include "quickfix/FileStore.h"
+#include "quickfix/FileLog.h"
+#include "quickfix/SessionSettings.h"
+#include "quickfix/fix42/NewOrderSingle.h"
+#include "quickfix/fix42/ExecutionReport.h"
+#include "quickfix/fix42/OrderCancelRequest.h"
+#include "quickfix/fix42/OrderCancelReject.h"
+
+using namespace std;
+
+#include "json.h"
+#include "_dec.h"
+#include "_b64.h"
+
+using namespace nlohmann;
+using namespace dec;
+
+#include "km.h"
+#include "fn.h"
+#include "cf.h"
+#include "ev.h"
+#include "mt.h"
+#include "tm.h"
+#include "db.h"
+#include "ui.h"
+#include "qp.h"
+#include "og.h"
+#include "mg.h"
+#include "pg.h"
+#include "qe.h"
+#include "sm.h"
+#include "jn.h"
+#include "en.h"
+#include "gw.h"
+//#include "do.h"
+
+#endif
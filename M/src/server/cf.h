@@ -4,6 +4,7 @@
 namespace K {
   static Gw *gw,
             *gW;
+  static Gw *gwE(mExchange e);
   class CF {
     public:
       static void main(int argc, char** argv) {
@@ -37,6 +38,14 @@ namespace K {
             {"user",         required_argument, 0,               'u'},
             {"pass",         required_argument, 0,               'p'},
             {"database",     required_argument, 0,               'd'},
+            {"db-sync",      required_argument, 0,               'y'},
+            {"record",       required_argument, 0,               'r'},
+            {"replay",       required_argument, 0,               'R'},
+            {"sim-latency",  required_argument, 0,               'L'},
+            {"sim-rate",     required_argument, 0,               'N'},
+            {"engine-cpu",   required_argument, 0,               'E'},
+            {"log-file",     required_argument, 0,               'F'},
+            {"http-timeout", required_argument, 0,               'O'},
             {"ewma-short",   required_argument, 0,               's'},
             {"ewma-medium",  required_argument, 0,               'm'},
             {"ewma-long",    required_argument, 0,               'l'},
@@ -60,6 +69,14 @@ namespace K {
             case 'e': argExchange = string(optarg); break;
             case 'c': argCurrency = string(optarg); break;
             case 'd': argDatabase = string(optarg); break;
+            case 'y': argDbSync = FN::S2u(string(optarg)); break;
+            case 'r': argRecord = string(optarg); break;
+            case 'R': argReplay = string(optarg); break;
+            case 'L': argSimLatency = stoi(optarg); break;
+            case 'N': argSimRate = stoi(optarg); break;
+            case 'E': argEngineCpu = stoi(optarg); break;
+            case 'F': argLogFile = string(optarg); break;
+            case 'O': argHttpTimeout = stoi(optarg); break;
             case 'k': argMatryoshka = string(optarg); break;
             case 'K': argTitle = string(optarg); break;
             case 'u': argUser = string(optarg); break;
@@ -87,7 +104,7 @@ namespace K {
               << FN::uiT() << RWHITE << "                           mandatory but may be 'NULL'." << '\n'
               << FN::uiT() << RWHITE << "-e, --exchange=NAME      - set exchange NAME for trading, mandatory one of:" << '\n'
               << FN::uiT() << RWHITE << "                           'COINBASE', 'BITFINEX', 'HITBTC', 'OKCOIN'," << '\n'
-              << FN::uiT() << RWHITE << "                           'KORBIT', 'POLONIEX' or 'NULL'." << '\n'
+              << FN::uiT() << RWHITE << "                           'KORBIT', 'POLONIEX', 'PEATIO' or 'NULL'." << '\n'
               << FN::uiT() << RWHITE << "-c, --currency=PAIRS     - set currency pairs for trading (use format" << '\n'
               << FN::uiT() << RWHITE << "                           with '/' separator, like 'BTC/EUR')." << '\n'
               << FN::uiT() << RWHITE << "-T, --target=NAME        - set orders destination (see '--exchange')," << '\n'
@@ -110,6 +127,23 @@ namespace K {
               << FN::uiT() << RWHITE << "                           default PATH is '/data/db/K.*.*.*.db'," << '\n'
               << FN::uiT() << RWHITE << "                           any route to a filename is valid," << '\n'
               << FN::uiT() << RWHITE << "                           or use ':memory:' (see sqlite.org/inmemorydb.html)." << '\n'
+              << FN::uiT() << RWHITE << "    --db-sync=LEVEL      - set sqlite synchronous LEVEL of database writes," << '\n'
+              << FN::uiT() << RWHITE << "                           one of 'OFF', 'NORMAL' (default) or 'FULL'." << '\n'
+              << FN::uiT() << RWHITE << "    --record=FILE        - save all market data and order replies from the" << '\n'
+              << FN::uiT() << RWHITE << "                           exchange into a binary journal FILE." << '\n'
+              << FN::uiT() << RWHITE << "    --replay=FILE        - backtest against a journal FILE made with '--record'," << '\n'
+              << FN::uiT() << RWHITE << "                           on a simulated clock and with simulated fills," << '\n'
+              << FN::uiT() << RWHITE << "                           implies '--headless', '--naked' and '--autobot'." << '\n'
+              << FN::uiT() << RWHITE << "    --sim-latency=MS     - delay new and cancel orders by MS milliseconds" << '\n'
+              << FN::uiT() << RWHITE << "                           on the SIM exchange and on '--replay', default 0." << '\n'
+              << FN::uiT() << RWHITE << "    --sim-rate=NUMBER    - limit the synthetic flow of the SIM exchange" << '\n'
+              << FN::uiT() << RWHITE << "                           to NUMBER events per second, default 0 (no limit)." << '\n'
+              << FN::uiT() << RWHITE << "    --engine-cpu=NUMBER  - pin the engine thread to CPU NUMBER (linux only)," << '\n'
+              << FN::uiT() << RWHITE << "                           default -1 (not pinned)." << '\n'
+              << FN::uiT() << RWHITE << "    --log-file=FILE      - also append all log lines to FILE, rotated" << '\n'
+              << FN::uiT() << RWHITE << "                           into FILE.1 every 16MB." << '\n'
+              << FN::uiT() << RWHITE << "    --http-timeout=MS    - abort REST requests to the exchange after MS" << '\n'
+              << FN::uiT() << RWHITE << "                           milliseconds, default 10000." << '\n'
               << FN::uiT() << RWHITE << "-s, --ewma-short=PRICE   - set initial ewma short value," << '\n'
               << FN::uiT() << RWHITE << "                           overwrites the value from the database." << '\n'
               << FN::uiT() << RWHITE << "-m, --ewma-medium=PRICE  - set initial ewma medium value," << '\n'
@@ -151,11 +185,19 @@ namespace K {
           BBLACK[0] = 0; BRED[0]    = 0; BGREEN[0] = 0; BYELLOW[0] = 0;
           BBLUE[0]  = 0; BPURPLE[0] = 0; BCYAN[0]  = 0; BWHITE[0]  = 0;
         }
+        if (argReplay != "") {
+          argHeadless = 1;
+          argNaked = 1;
+          argAutobot = 1;
+          argExchange = "NULL";
+          argTarget = "REPLAY";
+          if (argDatabase == "") argDatabase = ":memory:";
+        } else if (FN::S2l(argExchange) == "sim" and argTarget == "NULL") argTarget = "SIM";
         if (!argNaked) FN::screen();
         if (argExchange == "") FN::logWar("CF", "Unable to read mandatory configurations, reading ENVIRONMENT vars instead");
       };
       static void api() {
-        gw = Gw::E(cfExchange());
+        gw = gwE(cfExchange());
         gw->name = argExchange;
         gw->base = cfBase();
         gw->quote = cfQuote();
@@ -189,11 +231,17 @@ namespace K {
         else if (k == "poloniex") return mExchange::Poloniex;
         else if (k == "korbit") return mExchange::Korbit;
         else if (k == "hitbtc") return mExchange::HitBtc;
+        else if (k == "peatio") return mExchange::Peatio;
+        else if (k == "sim") return mExchange::Sim;
         else if (k == "null") return mExchange::Null;
         FN::logErr("CF", string("Invalid configuration value \"") + k + "\" as EXCHANGE. See https://github.com/ctubio/Krypto-trading-bot/tree/master/etc#configuration-options for more information");
         exit(EXIT_SUCCESS);
       };
     private:
+      friend class UT;
+      static double cfNumber(const json &k) {
+        return k.is_number() ? k.get<double>() : (k.is_string() ? stod(k.get<string>()) : 0);
+      };
       static void cfExchange(mExchange e) {
         if (e == mExchange::Coinbase) {
           system("test -n \"`/bin/pidof stunnel`\" && kill -9 `/bin/pidof stunnel`");
@@ -238,7 +286,22 @@ namespace K {
             os >> gw->minTick;
             gw->minSize = 0.01;
           }
-        } else if (e == mExchange::Null) {
+        } else if (e == mExchange::Peatio) {
+          json k = FN::wJet(string(gw->http).append("/api/v2/markets"));
+          for (json::iterator it = k.begin(); k.is_array() and it != k.end(); ++it) {
+            if (!it->is_object() or it->value("id", "") != gw->symbol) continue;
+            json tick = it->find("price_precision") != it->end() ? (*it)["price_precision"] : (*it)["bid_precision"],
+                 size = it->find("amount_precision") != it->end() ? (*it)["amount_precision"] : (*it)["ask_precision"];
+            if (!tick.is_number() or !size.is_number()) {
+              FN::logErr("CF", string("Missing price or amount precision of market \"") + gw->symbol + "\" at " + gw->http + "/api/v2/markets");
+              exit(EXIT_FAILURE);
+            }
+            gw->minTick = pow(10, -tick.get<int>());
+            gw->minSize = fmax(pow(10, -size.get<int>()), it->find("min_amount") != it->end()
+              ? cfNumber((*it)["min_amount"])
+              : fmax(cfNumber((*it)["min_ask_amount"]), cfNumber((*it)["min_bid_amount"])));
+          }
+        } else if (e == mExchange::Null and !gw->minTick) {
           gw->minTick = 0.01;
           gw->minSize = 0.01;
         }
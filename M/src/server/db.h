@@ -2,7 +2,22 @@
 #define K_DB_H_
 
 namespace K {
+  struct dbJob {
+     uiTXT k;
+      json o;
+      bool rm;
+    string id;
+      long time;
+    dbJob *next;
+  };
   static sqlite3* db;
+  static atomic<dbJob*> dbQueue(nullptr);
+  static atomic<unsigned long> dbQueued(0),
+                               dbDone(0);
+  static mutex dbMutex;
+  static condition_variable dbCond,
+                            dbFlushed;
+  static map<string, sqlite3_stmt*> dbStmt;
   class DB {
     public:
       static void main() {
@@ -12,17 +27,20 @@ namespace K {
           FN::logErr("DB", sqlite3_errmsg(db));
           exit(1);
         }
+        if (argDbSync != "OFF" and argDbSync != "NORMAL" and argDbSync != "FULL") {
+          FN::logWar("DB", string("Unknown sync level ") + argDbSync + ", using NORMAL instead");
+          argDbSync = "NORMAL";
+        }
+        exec("PRAGMA journal_mode=WAL;");
+        exec(string("PRAGMA synchronous=") + argDbSync + ";");
         FN::logDB(argDatabase);
+        thread([&]() {
+          while (true) write();
+        }).detach();
       };
       static json load(uiTXT k) {
+        create(k);
         char* zErrMsg = 0;
-        sqlite3_exec(db,
-          string("CREATE TABLE ").append(string(1, (char)k)).append("("                 \
-          "id    INTEGER  PRIMARY KEY  AUTOINCREMENT        NOT NULL," \
-          "json  BLOB                                       NOT NULL," \
-          "time  TIMESTAMP DEFAULT (CAST((julianday('now') - 2440587.5)*86400000 AS INTEGER))  NOT NULL);").data(),
-          NULL, NULL, &zErrMsg
-        );
         string j = "[";
         sqlite3_exec(db,
           string("SELECT json FROM ").append(string(1, (char)k)).append(" ORDER BY time DESC;").data(),
@@ -34,18 +52,15 @@ namespace K {
         return json::parse(j.append("]"));
       };
       static void insert(uiTXT k, json o, bool rm = true, string id = "NULL", long time = 0) {
-        char* zErrMsg = 0;
-        sqlite3_exec(db,
-          string((rm or id != "NULL" or time) ? string("DELETE FROM ").append(string(1, (char)k))
-          .append(id != "NULL" ? string(" WHERE id = ").append(id).append(";") : (
-            time ? string(" WHERE time < ").append(to_string(time)).append(";") : ";"
-          ) ) : "").append(o.is_null() ? "" : string("INSERT INTO ")
-            .append(string(1, (char)k)).append(" (id,json) VALUES(").append(id).append(",'")
-            .append(o.dump()).append("');")).data(),
-          NULL, NULL, &zErrMsg
-        );
-        if (zErrMsg) FN::logWar("DB", string("Sqlite error: ") + zErrMsg);
-        sqlite3_free(zErrMsg);
+        dbJob *job = new dbJob{k, move(o), rm, id, time, dbQueue.load(memory_order_relaxed)};
+        while (!dbQueue.compare_exchange_weak(job->next, job, memory_order_release, memory_order_relaxed));
+        ++dbQueued;
+        dbCond.notify_one();
+      };
+      static void flush() {
+        unique_lock<mutex> lock(dbMutex);
+        dbCond.notify_one();
+        dbFlushed.wait_for(lock, chrono::seconds(5), []() { return dbDone >= dbQueued; });
       };
       static int size() {
         if (argDatabase==":memory:") return 0;
@@ -53,6 +68,83 @@ namespace K {
         return stat(argDatabase.data(), &st) != 0 ? 0 : st.st_size;
       };
     private:
+      static void write() {
+        dbJob *k = dbQueue.exchange(nullptr, memory_order_acquire);
+        if (!k) {
+          unique_lock<mutex> lock(dbMutex);
+          dbCond.wait_for(lock, chrono::milliseconds(100), []() { return dbQueue.load(memory_order_relaxed) != nullptr; });
+          return;
+        }
+        dbJob *jobs = nullptr;
+        unsigned long n = 0;
+        while (k) {
+          dbJob *next = k->next;
+          k->next = jobs;
+          jobs = k;
+          k = next;
+          ++n;
+        }
+        exec("BEGIN;");
+        while (jobs) {
+          write(jobs);
+          k = jobs;
+          jobs = jobs->next;
+          delete k;
+        }
+        exec("COMMIT;");
+        dbDone += n;
+        lock_guard<mutex> lock(dbMutex);
+        dbFlushed.notify_all();
+      };
+      static void write(dbJob *k) {
+        if (k->rm or k->id != "NULL" or k->time) {
+          sqlite3_stmt *stmt = k->id != "NULL"
+            ? prepare(k->k, 'i', "DELETE FROM %s WHERE id = ?;")
+            : (k->time
+              ? prepare(k->k, 't', "DELETE FROM %s WHERE time < ?;")
+              : prepare(k->k, 'd', "DELETE FROM %s;"));
+          if (k->id != "NULL") sqlite3_bind_text(stmt, 1, k->id.data(), k->id.length(), SQLITE_TRANSIENT);
+          else if (k->time) sqlite3_bind_int64(stmt, 1, k->time);
+          step(stmt);
+        }
+        if (k->o.is_null()) return;
+        sqlite3_stmt *stmt = prepare(k->k, 'I', "INSERT INTO %s (id,json) VALUES(?,?);");
+        if (k->id != "NULL") sqlite3_bind_text(stmt, 1, k->id.data(), k->id.length(), SQLITE_TRANSIENT);
+        else sqlite3_bind_null(stmt, 1);
+        string o = k->o.dump();
+        sqlite3_bind_text(stmt, 2, o.data(), o.length(), SQLITE_TRANSIENT);
+        step(stmt);
+      };
+      static sqlite3_stmt *prepare(uiTXT k, char type, string sql) {
+        string key = string(1, (char)k) + type;
+        map<string, sqlite3_stmt*>::iterator it = dbStmt.find(key);
+        if (it != dbStmt.end()) return it->second;
+        create(k);
+        sql.replace(sql.find("%s"), 2, string(1, (char)k));
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql.data(), -1, &stmt, NULL) != SQLITE_OK)
+          FN::logWar("DB", string("Sqlite error: ") + sqlite3_errmsg(db));
+        return dbStmt[key] = stmt;
+      };
+      static void step(sqlite3_stmt *stmt) {
+        if (!stmt) return;
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+          FN::logWar("DB", string("Sqlite error: ") + sqlite3_errmsg(db));
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+      };
+      static void create(uiTXT k) {
+        exec(string("CREATE TABLE IF NOT EXISTS ").append(string(1, (char)k)).append("(" \
+          "id    INTEGER  PRIMARY KEY  AUTOINCREMENT        NOT NULL," \
+          "json  BLOB                                       NOT NULL," \
+          "time  TIMESTAMP DEFAULT (CAST((julianday('now') - 2440587.5)*86400000 AS INTEGER))  NOT NULL);"));
+      };
+      static void exec(string sql) {
+        char* zErrMsg = 0;
+        sqlite3_exec(db, sql.data(), NULL, NULL, &zErrMsg);
+        if (zErrMsg) FN::logWar("DB", string("Sqlite error: ") + zErrMsg);
+        sqlite3_free(zErrMsg);
+      };
       static int cb(void *param, int argc, char **argv, char **azColName) {
         string* j = reinterpret_cast<string*>(param);
         for (int i=0; i<argc; i++) j->append(argv[i]).append(",");
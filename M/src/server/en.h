@@ -0,0 +1,218 @@
+#ifndef K_EN_H_
+#define K_EN_H_
+
+namespace K {
+  enum class enType: unsigned char { Levels, Level, Trade, Order, Wallet, ConnectOrder, ConnectMarket, Message, Call };
+  struct enEvent {
+           enType type;
+          mLevels levels;
+            mSide side;
+           mLevel level;
+    unsigned long seq;
+           mTrade trade;
+           mOrder order;
+          mWallet wallet;
+    mConnectivity connectivity;
+           uiMsg_ cb;
+             json msg;
+    function<void()> fn;
+  };
+  struct enRing {
+    static const unsigned int size = 1024;
+    enEvent slot[size];
+    char pad0[64];
+    atomic<unsigned long> head{0};
+    char pad1[64];
+    atomic<unsigned long> tail{0};
+    char pad2[64];
+    atomic<bool> used{true};
+  };
+  static thread_local struct enOwner { // hands the ring over to a later thread once this one exits
+    enRing *r = nullptr;
+    ~enOwner() { if (r) r->used.store(false, memory_order_release); };
+  } enOwner;
+  static const unsigned int enRingsMax = 64;
+  static atomic<enRing*> enRings[enRingsMax];
+  static atomic<unsigned int> enRingsN(0);
+  static enRing *enShared = nullptr; // taken under enSharedMutex by producers once every ring is owned
+  static mutex enSharedMutex;
+  static atomic<bool> enIdle(false);
+  static mutex enMutex;
+  static condition_variable enCond;
+  static thread_local bool enThread = false;
+  static evLevels enLevels;
+  static evLevel enLevel;
+  static evTrade enTrade;
+  static evOrder enOrder;
+  static evWallet enWallet;
+  static evConnect enConnectOrder,
+                   enConnectMarket;
+  class EN {
+    public:
+      static void main() {
+        if (argReplay != "") return;
+        enLevels = ev_gwDataLevels;
+        enLevel = ev_gwDataLevel;
+        enTrade = ev_gwDataTrade;
+        enOrder = ev_gwDataOrder;
+        enWallet = ev_gwDataWallet;
+        enConnectOrder = ev_gwConnectOrder;
+        enConnectMarket = ev_gwConnectMarket;
+        ev_gwDataLevels = [](mLevels k) {
+          enEvent e;
+          e.type = enType::Levels;
+          e.levels = move(k);
+          push(e);
+        };
+        ev_gwDataLevel = [](mSide s, mLevel k, unsigned long seq) {
+          enEvent e;
+          e.type = enType::Level;
+          e.side = s;
+          e.level = k;
+          e.seq = seq;
+          push(e);
+        };
+        ev_gwDataTrade = [](mTrade k) {
+          enEvent e;
+          e.type = enType::Trade;
+          e.trade = k;
+          push(e);
+        };
+        ev_gwDataOrder = [](mOrder k) {
+          enEvent e;
+          e.type = enType::Order;
+          e.order = k;
+          push(e);
+        };
+        ev_gwDataWallet = [](mWallet k) {
+          enEvent e;
+          e.type = enType::Wallet;
+          e.wallet = k;
+          push(e);
+        };
+        ev_gwConnectOrder = [](mConnectivity k) {
+          enEvent e;
+          e.type = enType::ConnectOrder;
+          e.connectivity = k;
+          push(e);
+        };
+        ev_gwConnectMarket = [](mConnectivity k) {
+          enEvent e;
+          e.type = enType::ConnectMarket;
+          e.connectivity = k;
+          push(e);
+        };
+        uiDispatch = [](uiMsg_ cb, json k) {
+          enEvent e;
+          e.type = enType::Message;
+          e.cb = cb;
+          e.msg = move(k);
+          push(e);
+        };
+        tmDispatch = [](function<void()> fn) {
+          enEvent e;
+          e.type = enType::Call;
+          e.fn = move(fn);
+          push(e);
+        };
+        uiSnapDispatch = [](uiSnap_ cb) {
+          promise<json> k;
+          enEvent e;
+          e.type = enType::Call;
+          e.fn = [cb, &k]() { k.set_value((*cb)()); };
+          push(e);
+          return k.get_future().get();
+        };
+        enShared = ring();
+        thread([&]() { engine(); }).detach();
+      };
+    private:
+      friend class UT;
+      static void push(enEvent &k) {
+        if (enThread) return run(k);
+        if (!enOwner.r and !(enOwner.r = ring())) {
+          lock_guard<mutex> lock(enSharedMutex);
+          return put(enShared, k);
+        }
+        put(enOwner.r, k);
+      };
+      static void put(enRing *r, enEvent &k) {
+        unsigned long t = r->tail.load(memory_order_relaxed);
+        while (t - r->head.load(memory_order_acquire) == enRing::size) this_thread::yield();
+        r->slot[t % enRing::size] = move(k);
+        r->tail.store(t + 1, memory_order_release);
+        if (enIdle.load(memory_order_acquire)) enCond.notify_one();
+      };
+      static bool pop(enRing *r, enEvent &k) {
+        unsigned long h = r->head.load(memory_order_relaxed);
+        if (h == r->tail.load(memory_order_acquire)) return false;
+        k = move(r->slot[h % enRing::size]);
+        r->head.store(h + 1, memory_order_release);
+        return true;
+      };
+      static enRing *ring() {
+        unsigned int n = enRingsN.load(memory_order_acquire);
+        for (unsigned int i = 0; i < n; ++i) {
+          enRing *k = enRings[i].load(memory_order_relaxed);
+          bool used = false;
+          if (k->used.compare_exchange_strong(used, true, memory_order_acquire)) return k;
+        }
+        lock_guard<mutex> lock(enMutex);
+        n = enRingsN.load(memory_order_relaxed);
+        if (n == enRingsMax) return nullptr;
+        enRing *k = new enRing();
+        enRings[n].store(k, memory_order_relaxed);
+        enRingsN.store(n + 1, memory_order_release);
+        return k;
+      };
+      static void engine() {
+        enThread = true;
+#ifdef __linux__
+        if (argEngineCpu >= 0) {
+          cpu_set_t cpu;
+          CPU_ZERO(&cpu);
+          CPU_SET(argEngineCpu, &cpu);
+          if (pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu))
+            FN::logWar("EN", string("Unable to pin the engine thread to CPU ") + to_string(argEngineCpu));
+        }
+#endif
+        enEvent k;
+        unsigned int idle = 0;
+        while (true) {
+          bool busy = false;
+          unsigned int n = enRingsN.load(memory_order_acquire);
+          for (unsigned int i = 0; i < n; ++i) {
+            enRing *r = enRings[i].load(memory_order_relaxed);
+            for (unsigned int j = 0; j < 64 and pop(r, k); ++j) {
+              run(k);
+              busy = true;
+            }
+          }
+          QE::calcPending();
+          if (busy) idle = 0;
+          else if (++idle < 1000) this_thread::yield();
+          else {
+            unique_lock<mutex> lock(enMutex);
+            enIdle = true;
+            enCond.wait_for(lock, chrono::milliseconds(1));
+            enIdle = false;
+          }
+        }
+      };
+      static void run(enEvent &k) {
+        switch (k.type) {
+          case enType::Levels: enLevels(move(k.levels)); break;
+          case enType::Level: enLevel(k.side, k.level, k.seq); break;
+          case enType::Trade: enTrade(k.trade); break;
+          case enType::Order: enOrder(k.order); break;
+          case enType::Wallet: enWallet(k.wallet); break;
+          case enType::ConnectOrder: enConnectOrder(k.connectivity); break;
+          case enType::ConnectMarket: enConnectMarket(k.connectivity); break;
+          case enType::Message: k.cb(move(k.msg)); break;
+          case enType::Call: k.fn(); break;
+        }
+      };
+  };
+}
+
+#endif
@@ -7,6 +7,7 @@ namespace K {
   typedef void (*evTrade)        (mTrade);
   typedef void (*evWallet)       (mWallet);
   typedef void (*evLevels)       (mLevels);
+  typedef void (*evLevel)        (mSide, mLevel, unsigned long);
   typedef void (*evEmpty)        ();
   extern evConnect       ev_gwConnectButton,
                          ev_gwConnectOrder,
@@ -23,6 +24,8 @@ namespace K {
                          ev_mgTargetPosition,
                          ev_pgTargetBasePosition,
                          ev_uiQuotingParameters;
+  evLevel                ev_gwDataLevel;
+  evEmpty                ev_pgPosition;
   class EV {
     public:
       static void main() {
@@ -10,10 +10,161 @@
 #endif
 
 namespace K {
+  static atomic<unsigned long> fnT(0);
+  enum class fnLog: unsigned char { Err, DB, UI, UIsess, Ver, Trade, Value, Text, Raw };
+  struct fnLine {
+    chrono::system_clock::time_point T;
+    fnLog type;
+      int c;
+     bool b;
+    string k,
+           s,
+           v;
+  };
+  struct fnRing {
+    static const unsigned int size = 1024;
+    fnLine slot[size];
+    char pad0[64];
+    atomic<unsigned long> head{0};
+    char pad1[64];
+    atomic<unsigned long> tail{0};
+    char pad2[64];
+    atomic<bool> used{true};
+  };
+  static thread_local struct fnOwner { // hands the ring over to a later thread once this one exits
+    fnRing *r = nullptr;
+    ~fnOwner() { if (r) r->used.store(false, memory_order_release); };
+  } fnOwner;
+  static const unsigned int fnRingsMax = 64;
+  static atomic<fnRing*> fnRings[fnRingsMax];
+  static atomic<unsigned int> fnRingsN(0);
+  static atomic<unsigned long> fnDropped(0);
+  static mutex fnLogMutex;
+  static vector<mOrder> wOrders;
+  static condition_variable wCond;
+  static atomic<bool> wDirty(false),
+                      wResize(false);
+  static ofstream fnLogFile;
+  struct wRequest {
+    string method,
+           url,
+           post,
+           body;
+    vector<string> headers;
+    curl_slist *h = nullptr;
+    long timeout;
+    unsigned long T;
+    function<void(string)> cb;
+  };
+  static const unsigned int wIdleMax = 16;
+  static deque<wRequest*> wQueue;
+  static mutex wQueueMutex;
+  static vector<CURL*> wIdle;
+  static CURLM *wMulti = nullptr;
+  static CURLSH *wShare = nullptr;
+  static int wWake[2] = {-1, -1};
+  static mHistogram wLatency; // written only by the transport thread
+  static thread_local bool wThread = false;
+  struct fnScan { // forward-only reader over a json buffer, fills plain fields in place without building a DOM
+    const char *p,
+               *e;
+    fnScan(const char *k, size_t n):
+      p(k), e(k + n)
+    {};
+    static bool is(const char *k, size_t n, const char *w) {
+      return strlen(w) == n and !memcmp(k, w, n);
+    };
+    bool at(char c) {
+      while (p < e and (*p == ' ' or *p == '\t' or *p == '\n' or *p == '\r')) ++p;
+      return p < e and *p == c;
+    };
+    bool eat(char c) {
+      if (!at(c)) return false;
+      ++p;
+      return true;
+    };
+    bool str(const char *&k, size_t &n) {
+      if (!eat('"')) return false;
+      k = p;
+      while (p < e and *p != '"')
+        if (*p++ == '\\') return false; // escaped strings are left to the DOM path
+      if (p == e) return false;
+      n = p++ - k;
+      return true;
+    };
+    bool num(double &k) {
+      static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+      bool quoted = eat('"'),
+           neg = p < e and *p == '-';
+      if (neg) ++p;
+      const char *b = p;
+      unsigned long m = 0;
+      int d = 0,
+          x = 0;
+      const char *digits = p;
+      for (; p < e and *p >= '0' and *p <= '9'; ++p)
+        if (d < 19) { m = m * 10 + (*p - '0'); if (m) ++d; }
+        else ++x;
+      if (p == digits) return false;
+      if (p < e and *p == '.')
+        for (++p; p < e and *p >= '0' and *p <= '9'; ++p)
+          if (d < 19) { m = m * 10 + (*p - '0'); if (m) ++d; --x; }
+      if (p < e and (*p == 'e' or *p == 'E')) {
+        ++p;
+        bool neg_ = p < e and *p == '-';
+        if (p < e and (*p == '-' or *p == '+')) ++p;
+        int x_ = 0;
+        for (digits = p; p < e and *p >= '0' and *p <= '9'; ++p)
+          if (x_ < 1000) x_ = x_ * 10 + (*p - '0');
+        if (p == digits) return false;
+        x += neg_ ? -x_ : x_;
+      }
+      if (quoted and (p == e or *p++ != '"')) return false;
+      if (m < (1UL << 53) and x >= -22 and x <= 22) // both exact, so a single rounding like strtod
+        k = x < 0 ? m / pow10[-x] : m * pow10[x];
+      else k = strtod(string(b, p - quoted).data(), nullptr);
+      if (neg) k = -k;
+      return true;
+    };
+    template <typename F> bool object(F fn) { // fn(key, length) consumes the value
+      const char *k;
+      size_t n;
+      if (!eat('{')) return false;
+      if (eat('}')) return true;
+      do if (!str(k, n) or !eat(':') or !fn(k, n)) return false; while (eat(','));
+      return eat('}');
+    };
+    template <typename F> bool array(F fn) { // fn() consumes one element
+      if (!eat('[')) return false;
+      if (eat(']')) return true;
+      do if (!fn()) return false; while (eat(','));
+      return eat(']');
+    };
+    bool skip(unsigned int depth = 0) {
+      if (depth > 64) return false;
+      if (at('{')) return object([&](const char *k, size_t n) { return skip(depth + 1); });
+      if (at('[')) return array([&]() { return skip(depth + 1); });
+      if (eat('"')) {
+        for (; p < e and *p != '"'; ++p)
+          if (*p == '\\' and ++p == e) return false;
+        return p++ < e;
+      }
+      const char *w[] = {"true", "false", "null"};
+      for (unsigned int i = 0; i < 3; ++i)
+        if ((size_t)(e - p) >= strlen(w[i]) and !memcmp(p, w[i], strlen(w[i]))) {
+          p += strlen(w[i]);
+          return true;
+        }
+      double k;
+      return num(k);
+    };
+  };
   class FN {
     public:
       static string S2l(string k) { transform(k.begin(), k.end(), k.begin(), ::tolower); return k; };
       static string S2u(string k) { transform(k.begin(), k.end(), k.begin(), ::toupper); return k; };
+      static long ticks(double value, double minTick) { return llround(value / minTick); };
       static double roundNearest(double value, double minTick) { return round(value / minTick) * minTick; };
       static double roundUp(double value, double minTick) { return ceil(value / minTick) * minTick; };
       static double roundDown(double value, double minTick) { return floor(value / minTick) * minTick; };
@@ -22,10 +173,30 @@ namespace K {
         else if (oS == mSide::Ask) return roundUp(oP, minTick);
         else return roundNearest(oP, minTick);
       };
-      static unsigned long T() { return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count(); };
-      static string uiT() {
+      static unsigned long T() { unsigned long k = fnT.load(memory_order_relaxed); return k ? k : chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count(); };
+      static void T(unsigned long k) { fnT.store(k, memory_order_relaxed); };
+      static string uid() {
+        static atomic<unsigned long> id(chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count());
+        unsigned long k = ++id;
+        char s[13], *p = s + sizeof(s);
+        do *--p = "0123456789abcdefghijklmnopqrstuvwxyz"[k % 36]; while (k /= 36);
+        return string(p, s + sizeof(s) - p);
+      };
+      static unsigned long Tns() { return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count(); };
+      static string uiT(chrono::system_clock::time_point now = chrono::system_clock::now()) {
+        string T = stamp(now);
+        if (!wInit) return string(BGREEN) + T.substr(0, 8) + RGREEN + T.substr(8) + BWHITE + " ";
+        wattron(wLog, COLOR_PAIR(COLOR_GREEN));
+        wattron(wLog, A_BOLD);
+        wprintw(wLog, T.substr(0, 8).data());
+        wattroff(wLog, A_BOLD);
+        wprintw(wLog, T.substr(8).data());
+        wattroff(wLog, COLOR_PAIR(COLOR_GREEN));
+        wprintw(wLog, " ");
+        return "";
+      };
+      static string stamp(chrono::system_clock::time_point now) {
         typedef chrono::duration<int, ratio_multiply<chrono::hours::period, ratio<24>>::type> fnT;
-        chrono::time_point<chrono::system_clock> now = chrono::system_clock::now();
         auto t = now.time_since_epoch();
         fnT days = chrono::duration_cast<fnT>(t);
         t -= days;
@@ -38,18 +209,10 @@ namespace K {
         auto milliseconds = chrono::duration_cast<chrono::milliseconds>(t);
         t -= milliseconds;
         auto microseconds = chrono::duration_cast<chrono::microseconds>(t);
-        stringstream T, T_;
-        T << setfill('0') << setw(2) << hours.count() << ":" << setw(2) << minutes.count() << ":" << setw(2) << seconds.count();
-        T_ << "." << setfill('0') << setw(3) << milliseconds.count() << setw(3) << microseconds.count();
-        if (!wInit) return string(BGREEN) + T.str() + RGREEN + T_.str() + BWHITE + " ";
-        wattron(wLog, COLOR_PAIR(COLOR_GREEN));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, T.str().data());
-        wattroff(wLog, A_BOLD);
-        wprintw(wLog, T_.str().data());
-        wattroff(wLog, COLOR_PAIR(COLOR_GREEN));
-        wprintw(wLog, " ");
-        return "";
+        stringstream T;
+        T << setfill('0') << setw(2) << hours.count() << ":" << setw(2) << minutes.count() << ":" << setw(2) << seconds.count()
+          << "." << setw(3) << milliseconds.count() << setw(3) << microseconds.count();
+        return T.str();
       };
       static string oHex(string k) {
        int len = k.length();
@@ -75,12 +238,12 @@ namespace K {
         for(int i = 0; i < SHA512_DIGEST_LENGTH; i++) sprintf(&k_[i*2], "%02x", (unsigned int)digest[i]);
         return k_;
       };
-      static string oHmac256(string p, string s) {
+      static string oHmac256(string p, string s, bool hex = false) {
         unsigned char* digest;
         digest = HMAC(EVP_sha256(), s.data(), s.length(), (unsigned char*)p.data(), p.length(), NULL, NULL);
         char k_[SHA256_DIGEST_LENGTH*2+1];
         for(int i = 0; i < SHA256_DIGEST_LENGTH; i++) sprintf(&k_[i*2], "%02x", (unsigned int)digest[i]);
-        return oHex(k_);
+        return hex ? k_ : oHex(k_);
       };
       static string oHmac512(string p, string s) {
         unsigned char* digest;
@@ -100,236 +263,123 @@ namespace K {
         return json::parse(wGet(k));
       };
       static string wGet(string k) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wGet failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("GET", k, "", {}));
       };
       static json wJet(string k, string p) {
         return json::parse(wGet(k, p));
       };
       static string wGet(string k, string p) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, p.data());
-          h_ = curl_slist_append(h_, "Content-Type: application/x-www-form-urlencoded");
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wPost failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("POST", k, p, {"Content-Type: application/x-www-form-urlencoded"}));
       };
       static json wJet(string k, string t, bool auth) {
         return json::parse(wGet(k, t, auth));
       };
       static string wGet(string k, string t, bool auth) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          if (t != "") h_ = curl_slist_append(h_, string("Authorization: Bearer ").append(t).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wPost failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        vector<string> h;
+        if (t != "") h.push_back(string("Authorization: Bearer ").append(t));
+        return wJson(wSync("GET", k, "", h));
       };
       static json wJet(string k, string p, string s) {
         return json::parse(wGet(k, p, s));
       };
       static string wGet(string k, string p, string s) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          h_ = curl_slist_append(h_, string("X-Signature: ").append(s).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wGet failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("GET", k, "", {string("X-Signature: ").append(s)}));
       };
       static json wJet(string k, string p, string s, bool post) {
         return json::parse(wGet(k, p, s, post));
       };
       static string wGet(string k, string p, string s, bool post) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, p.data());
-          h_ = curl_slist_append(h_, string("X-Signature: ").append(s).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wPost failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("POST", k, p, {string("X-Signature: ").append(s)}));
       };
       static json wJet(string k, string p, string a, string s) {
         return json::parse(wGet(k, p, a, s));
       };
       static string wGet(string k, string p, string a, string s) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, p.data());
-          h_ = curl_slist_append(h_, "Content-Type: application/x-www-form-urlencoded");
-          h_ = curl_slist_append(h_, string("Key: ").append(a).data());
-          h_ = curl_slist_append(h_, string("Sign: ").append(s).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wPost failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("POST", k, p, {
+          "Content-Type: application/x-www-form-urlencoded",
+          string("Key: ").append(a),
+          string("Sign: ").append(s)
+        }));
       };
       static json wJet(string k, string p, string a, string s, bool post) {
         return json::parse(wGet(k, p, a, s, post));
       };
       static string wGet(string k, string p, string a, string s, bool post) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, p.data());
-          h_ = curl_slist_append(h_, string("X-BFX-APIKEY: ").append(a).data());
-          h_ = curl_slist_append(h_, string("X-BFX-PAYLOAD: ").append(p).data());
-          h_ = curl_slist_append(h_, string("X-BFX-SIGNATURE: ").append(s).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wPost failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("POST", k, p, {
+          string("X-BFX-APIKEY: ").append(a),
+          string("X-BFX-PAYLOAD: ").append(p),
+          string("X-BFX-SIGNATURE: ").append(s)
+        }));
       };
       static json wJet(string k, string p, string a, string s, bool post, bool auth) {
         return json::parse(wGet(k, p, a, s, post, auth));
       };
       static string wGet(string k, string p, string t, string s, bool post, bool auth) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, p.data());
-          h_ = curl_slist_append(h_, "Content-Type: application/x-www-form-urlencoded");
-          if (t != "") h_ = curl_slist_append(h_, string("Authorization: Bearer ").append(t).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wPost failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        vector<string> h = {"Content-Type: application/x-www-form-urlencoded"};
+        if (t != "") h.push_back(string("Authorization: Bearer ").append(t));
+        return wJson(wSync("POST", k, p, h));
       };
       static json wJet(string k, string t, string a, string s, string p) {
         return json::parse(wGet(k, t, a, s, p));
       };
       static string wGet(string k, string t, string a, string s, string p) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          h_ = curl_slist_append(h_, string("CB-ACCESS-KEY: ").append(a).data());
-          h_ = curl_slist_append(h_, string("CB-ACCESS-SIGN: ").append(s).data());
-          h_ = curl_slist_append(h_, string("CB-ACCESS-TIMESTAMP: ").append(t).data());
-          h_ = curl_slist_append(h_, string("CB-ACCESS-PASSPHRASE: ").append(p).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wGet failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
-        }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        return wJson(wSync("GET", k, "", {
+          string("CB-ACCESS-KEY: ").append(a),
+          string("CB-ACCESS-SIGN: ").append(s),
+          string("CB-ACCESS-TIMESTAMP: ").append(t),
+          string("CB-ACCESS-PASSPHRASE: ").append(p)
+        }));
       };
       static json wJet(string k, string t, string a, string s, string p, bool d) {
         return json::parse(wGet(k, t, a, s, p, d));
       };
       static string wGet(string k, string t, string a, string s, string p, bool d) {
-        string k_;
-        CURL* curl;
-        curl = curl_easy_init();
-        if (curl) {
-          struct curl_slist *h_ = NULL;
-          curl_easy_setopt(curl, CURLOPT_URL, k.data());
-          curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &wcb);
-          h_ = curl_slist_append(h_, string("CB-ACCESS-KEY: ").append(a).data());
-          h_ = curl_slist_append(h_, string("CB-ACCESS-SIGN: ").append(s).data());
-          h_ = curl_slist_append(h_, string("CB-ACCESS-TIMESTAMP: ").append(t).data());
-          h_ = curl_slist_append(h_, string("CB-ACCESS-PASSPHRASE: ").append(p).data());
-          curl_easy_setopt(curl, CURLOPT_HTTPHEADER, h_);
-          curl_easy_setopt(curl, CURLOPT_WRITEDATA, &k_);
-          curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-          curl_easy_setopt(curl, CURLOPT_USERAGENT, "K");
-          CURLcode r = curl_easy_perform(curl);
-          if(r != CURLE_OK) FN::logWar("JSON", string("wGet failed ") + curl_easy_strerror(r));
-          curl_easy_cleanup(curl);
+        return wJson(wSync("DELETE", k, "", {
+          string("CB-ACCESS-KEY: ").append(a),
+          string("CB-ACCESS-SIGN: ").append(s),
+          string("CB-ACCESS-TIMESTAMP: ").append(t),
+          string("CB-ACCESS-PASSPHRASE: ").append(p)
+        }));
+      };
+      static bool book(const char *k, size_t n, mLevels &levels) {
+        fnScan s(k, n);
+        bool bids = false,
+             asks = false;
+        return s.object([&](const char *k, size_t n) {
+          if (fnScan::is(k, n, "bids")) return bids = side(s, levels.bids);
+          if (fnScan::is(k, n, "asks")) return asks = side(s, levels.asks);
+          return s.skip();
+        }) and bids and asks;
+      };
+      static string wJson(string k) {
+        if (!k.length() or (k[0]!='{' and k[0]!='[')) k = "{}";
+        return k;
+      };
+      static void wAsync(string method, string url, string post, vector<string> headers, function<void(string)> cb, long timeout = 0) {
+        wRequest *k = new wRequest();
+        k->method = method;
+        k->url = url;
+        k->post = post;
+        k->headers = headers;
+        k->timeout = timeout ? timeout : argHttpTimeout;
+        k->T = Tns();
+        k->cb = cb;
+        if (wThread) { // a callback asking for more, serve it inline rather than waiting on ourselves
+          CURL *c = wStart(k);
+          return wDone(c, k, c ? curl_easy_perform(c) : CURLE_FAILED_INIT);
         }
-        if (!k_.length() or (k_[0]!='{' and k_[0]!='[')) k_ = "{}";
-        return k_;
+        wTransport();
+        {
+          lock_guard<mutex> lock(wQueueMutex);
+          wQueue.push_back(k);
+        }
+        if (write(wWake[1], "", 1) < 0) {}; // a full pipe means the transport is already awake
+      };
+      static string wSync(string method, string url, string post, vector<string> headers, long timeout = 0) {
+        shared_ptr<promise<string>> k = make_shared<promise<string>>();
+        future<string> k_ = k->get_future();
+        wAsync(method, url, post, headers, [k](string body) { k->set_value(body); }, timeout);
+        return k_.get();
       };
       static size_t wcb(void *buf, size_t size, size_t nmemb, void *up) {
         ((string*)up)->append((char*)buf, size * nmemb);
@@ -392,195 +442,37 @@ namespace K {
         logErr(k, s, " Warrrrning: ");
       };
       static void logErr(string k, string s, string m = " Errrror: ") {
-        if (!wInit) {
-          cout << uiT() << k << RRED << m << BRED << s << ".\n";
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, k.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_RED));
-        wprintw(wLog, m.data());
-        wattroff(wLog, A_BOLD);
-        wprintw(wLog, s.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_RED));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, ".\n");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wrefresh(wLog);
+        push(fnLog::Err, move(k), move(s), move(m));
       };
       static void logDB(string k) {
-        if (!wInit) {
-          cout << uiT() << "DB " << RYELLOW << k << RWHITE << " loaded OK.\n";
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, "DB ");
-        wattroff(wLog, A_BOLD);
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wprintw(wLog, k.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, " loaded OK.\n");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wrefresh(wLog);
+        push(fnLog::DB, move(k));
       };
       static void logUI(string k, int p) {
-        if (!wInit) {
-          cout << uiT() << "UI" << RWHITE << " ready over " << RYELLOW << k << RWHITE << " on external port " << RYELLOW << to_string(p) << RWHITE << ".\n";
-          return;
-        }
-        wMutex.lock();
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, "UI");
-        wattroff(wLog, A_BOLD);
-        wprintw(wLog, " ready over ");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wprintw(wLog, k.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, " on external port ");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wprintw(wLog, to_string(p).data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, ".\n");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wMutex.unlock();
-        FN::screen_refresh();
+        push(fnLog::UI, move(k), to_string(p));
       };
       static void logUIsess(int k, string s) {
-        if (!wInit) {
-          cout << uiT() << "UI " << RYELLOW << to_string(k) << RWHITE << " currently connected, last connection was from " << RYELLOW << s << RWHITE << ".\n";
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, "UI ");
-        wattroff(wLog, A_BOLD);
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wprintw(wLog, to_string(k).data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, " currently connected, last connection was from ");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wprintw(wLog, s.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, ".\n");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wrefresh(wLog);
+        push(fnLog::UIsess, to_string(k), move(s));
       };
       static void logVer(string k, int c) {
-        if (!wInit) {
-          cout << BGREEN << "K" << RGREEN << string(" version ").append(!c ? "0day.\n" : string("-").append(to_string(c)).append("commit").append(c > 1?"s..\n":"..\n")) << RYELLOW << (c ? k : "") << RWHITE;
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        wattron(wLog, COLOR_PAIR(COLOR_GREEN));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, "K");
-        wattroff(wLog, A_BOLD);
-        wprintw(wLog, string(" version ").append(!c ? "0day.\n" : string("-").append(to_string(c)).append("commit").append(c > 1?"s..\n":"..\n")).data());
-        wattroff(wLog, COLOR_PAIR(COLOR_GREEN));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        if (c) wprintw(wLog, k.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wrefresh(wLog);
+        push(fnLog::Ver, move(k), "", "", c);
       };
       static void log(mTrade k, string e) {
-        if (!wInit) {
-          cout << FN::uiT() << "GW " << (k.side == mSide::Bid ? RCYAN : RPURPLE) << argExchange << " TRADE " << (k.side == mSide::Bid ? BCYAN : BPURPLE) << (k.side == mSide::Bid ? "BUY " : "SELL ") << k.quantity << " " << k.pair.base << " at price " << k.price << " " << k.pair.quote << " (value " << k.value << " " << k.pair.quote << ").\n";
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, A_BOLD);
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, "GW ");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(k.side == mSide::Bid ? COLOR_CYAN : COLOR_MAGENTA));
-        wprintw(wLog, string(e).append(" TRADE ").data());
-        wattroff(wLog, A_BOLD);
         stringstream ss;
         ss << setprecision(8) << fixed << (k.side == mSide::Bid ? "BUY " : "SELL ") << k.quantity << " " << k.pair.base << " at price " << k.price << " " << k.pair.quote << " (value " << k.value << " " << k.pair.quote << ")";
-        wprintw(wLog, ss.str().data());
-        wprintw(wLog, ".\n");
-        wattroff(wLog, COLOR_PAIR(k.side == mSide::Bid ? COLOR_CYAN : COLOR_MAGENTA));
-        wrefresh(wLog);
+        push(fnLog::Trade, move(e), ss.str(), "", (int)k.side);
       };
       static void log(string k, string s, string v) {
-        if (!wInit) {
-          cout << uiT() << k << RWHITE << " " << s << " " << RYELLOW << v << RWHITE << ".\n";
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, k.data());
-        wattroff(wLog, A_BOLD);
-        wprintw(wLog, string(" ").append(s).append(" ").data());
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wprintw(wLog, v.data());
-        wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wprintw(wLog, ".\n");
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wrefresh(wLog);
+        push(fnLog::Value, move(k), move(s), move(v));
       };
       static void log(string k, string s) {
-        if (!wInit) {
-          cout << uiT() << k << RWHITE << " " << s << ".\n";
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        uiT();
-        wattron(wLog, COLOR_PAIR(COLOR_WHITE));
-        wattron(wLog, A_BOLD);
-        wprintw(wLog, k.data());
-        wattroff(wLog, A_BOLD);
-        wprintw(wLog, string(" ").append(s).append(".\n").data());
-        wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
-        wrefresh(wLog);
+        push(fnLog::Text, move(k), move(s));
       };
       static void log(string k, int c = COLOR_WHITE, bool b = false) {
-        if (!wInit) {
-          cout << RWHITE << k;
-          return;
-        }
-        lock_guard<mutex> lock(wMutex);
-        wmove(wLog, getmaxy(wLog)-1, 0);
-        if (b) wattron(wLog, A_BOLD);
-        wattron(wLog, COLOR_PAIR(c));
-        wprintw(wLog, k.data());
-        wattroff(wLog, COLOR_PAIR(c));
-        if (b) wattroff(wLog, A_BOLD);
-        wrefresh(wLog);
+        push(fnLog::Raw, move(k), "", "", c, b);
+      };
+      static void logFlush() {
+        lock_guard<mutex> lock(fnLogMutex);
+        drain();
       };
       static void screen_quit() {
         if (!wInit) return;
@@ -626,97 +518,478 @@ namespace K {
           evExit(EXIT_SUCCESS);
         }).detach();
         wInit = true;
+        thread([&]() { screen_render(); }).detach();
         screen_refresh();
       };
-      static void screen_refresh() {
+      static void screen_orders(vector<mOrder> k) {
         if (!wInit) return;
-        static int p = 0, spin = 0;
-        multimap<double, mOrder> orderLines;
-        ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it) {
-          if (mORS::Working != it->second.orderStatus) continue;
-          orderLines.insert(pair<double, mOrder>(it->second.price, it->second));
+        {
+          lock_guard<mutex> lock(wMutex);
+          wOrders.swap(k);
         }
-        ogMutex.unlock();
-        lock_guard<mutex> lock(wMutex);
-        int l = p,
-            y = getmaxy(wBorder),
-            x = getmaxx(wBorder),
-            k = y - orderLines.size() - 1,
-            P = k;
-        while (l<y) mvwhline(wBorder, l++, 1, ' ', x-1);
-        if (k!=p) {
-          if (k<p) wscrl(wLog, p-k);
-          wresize(wLog, k-3, x-2);
-          if (k>p) wscrl(wLog, p-k);
-          wrefresh(wLog);
-          p = k;
+        screen_refresh();
+      };
+      static void screen_refresh() {
+        wDirty = true;
+        wCond.notify_one();
+      };
+      static void screen_resize(int sig) {
+        wResize = true;
+      };
+    private:
+      static bool side(fnScan &s, vector<mLevel> &levels) {
+        return s.array([&]() {
+          mLevel k;
+          unsigned int i = 0;
+          bool ok = s.at('[')
+            ? s.array([&]() { return ++i > 2 ? s.skip() : s.num(i == 1 ? k.price : k.size); })
+            : s.object([&](const char *k_, size_t n) {
+                if (fnScan::is(k_, n, "price")) { ++i; return s.num(k.price); }
+                if (fnScan::is(k_, n, "size") or fnScan::is(k_, n, "amount") or fnScan::is(k_, n, "volume")) { ++i; return s.num(k.size); }
+                return s.skip();
+              });
+          if (!ok or i < 2) return false;
+          levels.push_back(k);
+          return true;
+        });
+      };
+      static void wTransport() {
+        static once_flag running;
+        call_once(running, []() {
+          if (pipe(wWake) or fcntl(wWake[0], F_SETFL, O_NONBLOCK) or fcntl(wWake[1], F_SETFL, O_NONBLOCK)) {
+            FN::logErr("CURL", "Unable to create the transport wakeup pipe");
+            exit(EXIT_FAILURE);
+          }
+          wMulti = curl_multi_init();
+          wShare = curl_share_init();
+          curl_share_setopt(wShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+          curl_share_setopt(wShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+          thread([&]() { wLoop(); }).detach();
+        });
+      };
+      static void wLoop() {
+        wThread = true;
+        deque<wRequest*> k;
+        int running;
+        CURLMsg *m;
+        while (true) {
+          {
+            lock_guard<mutex> lock(wQueueMutex);
+            k.swap(wQueue);
+          }
+          for (deque<wRequest*>::iterator it = k.begin(); it != k.end(); ++it) {
+            CURL *c = wStart(*it);
+            if (!c) wDone(c, *it, CURLE_FAILED_INIT);
+            else curl_multi_add_handle(wMulti, c);
+          }
+          k.clear();
+          curl_multi_perform(wMulti, &running);
+          while ((m = curl_multi_info_read(wMulti, &running))) {
+            if (m->msg != CURLMSG_DONE) continue;
+            CURL *c = m->easy_handle;
+            CURLcode r = m->data.result;
+            char *k_ = nullptr;
+            curl_easy_getinfo(c, CURLINFO_PRIVATE, &k_);
+            curl_multi_remove_handle(wMulti, c);
+            wDone(c, (wRequest*)k_, r);
+          }
+          struct curl_waitfd wake = {wWake[0], CURL_WAIT_POLLIN, 0};
+          curl_multi_wait(wMulti, &wake, 1, 1000, nullptr);
+          if (wake.revents) {
+            char b[64];
+            while (read(wWake[0], b, sizeof(b)) > 0);
+          }
         }
-        mvwvline(wBorder, 1, 1, ' ', y-1);
-        mvwvline(wBorder, k-1, 1, ' ', y-1);
-        for (map<double, mOrder>::reverse_iterator it = orderLines.rbegin(); it != orderLines.rend(); ++it) {
-          wattron(wBorder, COLOR_PAIR(it->second.side == mSide::Bid ? COLOR_CYAN : COLOR_MAGENTA));
-          stringstream ss;
-          ss << setprecision(8) << fixed << (it->second.side == mSide::Bid ? "BID" : "ASK") << " > " << it->second.orderId << ": " << it->second.quantity << " " << it->second.pair.base << " at price " << it->second.price << " " << it->second.pair.quote;
-          mvwaddstr(wBorder, ++P, 1, ss.str().data());
-          wattroff(wBorder, COLOR_PAIR(it->second.side == mSide::Bid ? COLOR_CYAN : COLOR_MAGENTA));
+      };
+      static CURL *wStart(wRequest *k) {
+        CURL *c;
+        if (wIdle.empty()) c = curl_easy_init();
+        else {
+          c = wIdle.back();
+          wIdle.pop_back();
         }
-        mvwaddch(wBorder, 0, 0, ACS_ULCORNER);
-        mvwhline(wBorder, 0, 1, ACS_HLINE, max(80, x));
-        mvwvline(wBorder, 1, 0, ACS_VLINE, k);
-        mvwvline(wBorder, k, 0, ACS_LTEE, y);
-        mvwaddch(wBorder, y, 0, ACS_BTEE);
-        mvwaddch(wBorder, 0, 12, ACS_RTEE);
-        wattron(wBorder, COLOR_PAIR(COLOR_GREEN));
-        mvwaddstr(wBorder, 0, 13, (string("   ") + K_BUILD + " " + K_STAMP + " ").data());
-        mvwaddch(wBorder, 0, 14, 'K' | A_BOLD);
-        wattroff(wBorder, COLOR_PAIR(COLOR_GREEN));
-        mvwaddch(wBorder, 0, 18+string(K_BUILD).length()+string(K_STAMP).length(), ACS_LTEE);
-        mvwaddch(wBorder, 0, x-12, ACS_RTEE);
-        mvwaddstr(wBorder, 0, x-11, " [ ]: Quit!");
-        mvwaddch(wBorder, 0, x-9, 'q' | A_BOLD);
-        mvwaddch(wBorder, 0, 7, ACS_TTEE);
-        mvwaddch(wBorder, 1, 7, ACS_LLCORNER);
-        mvwhline(wBorder, 1, 8, ACS_HLINE, 4);
-        mvwaddch(wBorder, 1, 12, ACS_RTEE);
-        wattron(wBorder, COLOR_PAIR(COLOR_GREEN));
-        wattron(wBorder, A_BOLD);
-        mvwaddstr(wBorder, 1, 14, (argExchange + " " + argCurrency).data());
-        wattroff(wBorder, A_BOLD);
-        waddstr(wBorder, (argHeadless ? " headless" : " UI on " + uiPrtcl + " port " + to_string(argPort)).data());
-        wattroff(wBorder, COLOR_PAIR(COLOR_GREEN));
-        mvwaddch(wBorder, k, 0, ACS_LTEE);
-        mvwhline(wBorder, k, 1, ACS_HLINE, 3);
-        mvwaddch(wBorder, k, 4, ACS_RTEE);
-        mvwaddstr(wBorder, k, 5, "< (");
-        wattron(wBorder, COLOR_PAIR(COLOR_YELLOW));
-        waddstr(wBorder, to_string(orderLines.size()).data());
-        wattroff(wBorder, COLOR_PAIR(COLOR_YELLOW));
-        waddstr(wBorder, ") Open Orders..");
-        mvwaddch(wBorder, y-1, 0, ACS_LLCORNER);
-        mvwaddstr(wBorder, y-1, x-1, string("|/-\\").substr(++spin, 1).data());
-        if (spin==3) { spin = -1; }
-        move(k-1, 2);
-        wrefresh(wBorder);
-        wrefresh(wLog);
+        if (!c) return c;
+        curl_easy_setopt(c, CURLOPT_URL, k->url.data());
+        curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, &wcb);
+        curl_easy_setopt(c, CURLOPT_WRITEDATA, &k->body);
+        curl_easy_setopt(c, CURLOPT_USERAGENT, "K");
+        curl_easy_setopt(c, CURLOPT_TIMEOUT_MS, k->timeout);
+        curl_easy_setopt(c, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(c, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(c, CURLOPT_SHARE, wShare);
+        curl_easy_setopt(c, CURLOPT_PRIVATE, k);
+        if (k->method == "POST") {
+          curl_easy_setopt(c, CURLOPT_POSTFIELDSIZE, (long)k->post.length());
+          curl_easy_setopt(c, CURLOPT_POSTFIELDS, k->post.data());
+        } else if (k->method != "GET") curl_easy_setopt(c, CURLOPT_CUSTOMREQUEST, k->method.data());
+        for (vector<string>::iterator it = k->headers.begin(); it != k->headers.end(); ++it)
+          k->h = curl_slist_append(k->h, it->data());
+        curl_easy_setopt(c, CURLOPT_HTTPHEADER, k->h);
+        return c;
+      };
+      static void wDone(CURL *c, wRequest *k, CURLcode r) {
+        wLatency.record(Tns() - k->T);
+        if (r != CURLE_OK) {
+          FN::logWar("CURL", k->method + " " + k->url.substr(0, k->url.find('?')) + " failed " + curl_easy_strerror(r));
+          k->body.clear();
+        }
+        if (c) {
+          curl_easy_reset(c);
+          if (wIdle.size() < wIdleMax) wIdle.push_back(c);
+          else curl_easy_cleanup(c);
+        }
+        curl_slist_free_all(k->h);
+        k->cb(move(k->body));
+        delete k;
+      };
+      static void push(fnLog type, string k, string s = "", string v = "", int c = COLOR_WHITE, bool b = false) {
+        if (!fnOwner.r and !(fnOwner.r = ring())) return (void)fnDropped.fetch_add(1, memory_order_relaxed);
+        fnRing *r = fnOwner.r;
+        unsigned long t = r->tail.load(memory_order_relaxed);
+        if (t - r->head.load(memory_order_acquire) == fnRing::size) return (void)fnDropped.fetch_add(1, memory_order_relaxed);
+        fnLine &l = r->slot[t % fnRing::size];
+        l.T = chrono::system_clock::now();
+        l.type = type;
+        l.c = c;
+        l.b = b;
+        l.k = move(k);
+        l.s = move(s);
+        l.v = move(v);
+        r->tail.store(t + 1, memory_order_release);
+      };
+      static fnRing *ring() {
+        unsigned int n = fnRingsN.load(memory_order_acquire);
+        for (unsigned int i = 0; i < n; ++i) {
+          fnRing *k = fnRings[i].load(memory_order_relaxed);
+          bool used = false;
+          if (k->used.compare_exchange_strong(used, true, memory_order_acquire)) return k;
+        }
+        lock_guard<mutex> lock(fnLogMutex);
+        n = fnRingsN.load(memory_order_relaxed);
+        if (n == fnRingsMax) return nullptr;
+        fnRing *k = new fnRing();
+        fnRings[n].store(k, memory_order_relaxed);
+        fnRingsN.store(n + 1, memory_order_release);
+        if (!n) {
+          if (argLogFile != "") fnLogFile.open(argLogFile, ios::app);
+          atexit(logFlush);
+          thread([]() {
+            while (true) {
+              bool busy;
+              {
+                lock_guard<mutex> lock(fnLogMutex);
+                busy = drain();
+              }
+              if (!busy) this_thread::sleep_for(chrono::milliseconds(5));
+            }
+          }).detach();
+        }
+        return k;
+      };
+      static bool drain() {
+        bool busy = false;
+        unsigned int n = fnRingsN.load(memory_order_acquire);
+        for (unsigned int i = 0; i < n; ++i) {
+          fnRing *r = fnRings[i].load(memory_order_relaxed);
+          unsigned long h = r->head.load(memory_order_relaxed);
+          for (unsigned int j = 0; j < 256 and h != r->tail.load(memory_order_acquire); ++j, ++h) {
+            fnLine &l = r->slot[h % fnRing::size];
+            print(l);
+            if (fnLogFile.is_open()) file(l);
+            l.k = string();
+            l.s = string();
+            l.v = string();
+            r->head.store(h + 1, memory_order_release);
+            busy = true;
+          }
+        }
+        unsigned long dropped = fnDropped.exchange(0, memory_order_relaxed);
+        if (dropped) {
+          fnLine l = {chrono::system_clock::now(), fnLog::Err, 0, false, "FN", to_string(dropped) + " log lines dropped, the log ring was full", " Warrrrning: "};
+          print(l);
+          if (fnLogFile.is_open()) file(l);
+        }
+        if (busy and wInit) {
+          lock_guard<mutex> lock(wMutex);
+          if (wInit) wrefresh(wLog);
+        }
+        return busy;
+      };
+      static void file(const fnLine &l) {
+        fnLogFile << stamp(l.T) << " ";
+        switch (l.type) {
+          case fnLog::Err: fnLogFile << l.k << l.v << l.s << ".\n"; break;
+          case fnLog::DB: fnLogFile << "DB " << l.k << " loaded OK.\n"; break;
+          case fnLog::UI: fnLogFile << "UI ready over " << l.k << " on external port " << l.s << ".\n"; break;
+          case fnLog::UIsess: fnLogFile << "UI " << l.k << " currently connected, last connection was from " << l.s << ".\n"; break;
+          case fnLog::Ver: fnLogFile << "K version " << (!l.c ? "0day." : string("-").append(to_string(l.c)).append("commit").append(l.c > 1 ? "s.." : "..")) << "\n" << (l.c ? l.k : ""); break;
+          case fnLog::Trade: fnLogFile << "GW " << l.k << " TRADE " << l.s << ".\n"; break;
+          case fnLog::Value: fnLogFile << l.k << " " << l.s << " " << l.v << ".\n"; break;
+          case fnLog::Text: fnLogFile << l.k << " " << l.s << ".\n"; break;
+          case fnLog::Raw: fnLogFile << l.k; break;
+        }
+        if (fnLogFile.tellp() < 16 << 20) return fnLogFile.flush(), void();
+        fnLogFile.close();
+        rename(argLogFile.data(), (argLogFile + ".1").data());
+        fnLogFile.open(argLogFile, ios::trunc);
       };
-      static void screen_resize(int sig) {
-        if (!wInit) return;
-        wMutex.lock();
-        struct winsize ws;
-        if (ioctl(0, TIOCGWINSZ, &ws) < 0 or (ws.ws_row == getmaxy(wBorder) and ws.ws_col == getmaxx(wBorder))) {
-          wMutex.unlock();
+      static void print(const fnLine &l) {
+        const string &k = l.k, &s = l.s, &v = l.v;
+        if (!wInit) {
+          string T = stamp(l.T);
+          T = string(BGREEN) + T.substr(0, 8) + RGREEN + T.substr(8) + BWHITE + " ";
+          switch (l.type) {
+            case fnLog::Err: cout << T << k << RRED << v << BRED << s << ".\n"; break;
+            case fnLog::DB: cout << T << "DB " << RYELLOW << k << RWHITE << " loaded OK.\n"; break;
+            case fnLog::UI: cout << T << "UI" << RWHITE << " ready over " << RYELLOW << k << RWHITE << " on external port " << RYELLOW << s << RWHITE << ".\n"; break;
+            case fnLog::UIsess: cout << T << "UI " << RYELLOW << k << RWHITE << " currently connected, last connection was from " << RYELLOW << s << RWHITE << ".\n"; break;
+            case fnLog::Ver: cout << BGREEN << "K" << RGREEN << string(" version ").append(!l.c ? "0day.\n" : string("-").append(to_string(l.c)).append("commit").append(l.c > 1?"s..\n":"..\n")) << RYELLOW << (l.c ? k : "") << RWHITE; break;
+            case fnLog::Trade: cout << T << "GW " << ((mSide)l.c == mSide::Bid ? RCYAN : RPURPLE) << k << " TRADE " << ((mSide)l.c == mSide::Bid ? BCYAN : BPURPLE) << s << ".\n"; break;
+            case fnLog::Value: cout << T << k << RWHITE << " " << s << " " << RYELLOW << v << RWHITE << ".\n"; break;
+            case fnLog::Text: cout << T << k << RWHITE << " " << s << ".\n"; break;
+            case fnLog::Raw: cout << RWHITE << k; break;
+          }
           return;
         }
+        if (l.type == fnLog::UI) {
+          render(l);
+          return screen_refresh();
+        }
+        render(l);
+      };
+      static void render(const fnLine &l) {
+        const string &k = l.k, &s = l.s, &v = l.v;
+        lock_guard<mutex> lock(wMutex);
+        if (!wInit) return;
+        wmove(wLog, getmaxy(wLog)-1, 0);
+        switch (l.type) {
+          case fnLog::Err:
+            uiT(l.T);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, k.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_RED));
+            wprintw(wLog, v.data());
+            wattroff(wLog, A_BOLD);
+            wprintw(wLog, s.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_RED));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, ".\n");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            break;
+          case fnLog::DB:
+            uiT(l.T);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, "DB ");
+            wattroff(wLog, A_BOLD);
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wprintw(wLog, k.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, " loaded OK.\n");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            break;
+          case fnLog::UI:
+            uiT(l.T);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, "UI");
+            wattroff(wLog, A_BOLD);
+            wprintw(wLog, " ready over ");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wprintw(wLog, k.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, " on external port ");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wprintw(wLog, s.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, ".\n");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            break;
+          case fnLog::UIsess:
+            uiT(l.T);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, "UI ");
+            wattroff(wLog, A_BOLD);
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wprintw(wLog, k.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, " currently connected, last connection was from ");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wprintw(wLog, s.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, ".\n");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            break;
+          case fnLog::Ver:
+            wattron(wLog, COLOR_PAIR(COLOR_GREEN));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, "K");
+            wattroff(wLog, A_BOLD);
+            wprintw(wLog, string(" version ").append(!l.c ? "0day.\n" : string("-").append(to_string(l.c)).append("commit").append(l.c > 1?"s..\n":"..\n")).data());
+            wattroff(wLog, COLOR_PAIR(COLOR_GREEN));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            if (l.c) wprintw(wLog, k.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            break;
+          case fnLog::Trade:
+            uiT(l.T);
+            wattron(wLog, A_BOLD);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, "GW ");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR((mSide)l.c == mSide::Bid ? COLOR_CYAN : COLOR_MAGENTA));
+            wprintw(wLog, string(k).append(" TRADE ").data());
+            wattroff(wLog, A_BOLD);
+            wprintw(wLog, s.data());
+            wprintw(wLog, ".\n");
+            wattroff(wLog, COLOR_PAIR((mSide)l.c == mSide::Bid ? COLOR_CYAN : COLOR_MAGENTA));
+            break;
+          case fnLog::Value:
+            uiT(l.T);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, k.data());
+            wattroff(wLog, A_BOLD);
+            wprintw(wLog, string(" ").append(s).append(" ").data());
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wprintw(wLog, v.data());
+            wattroff(wLog, COLOR_PAIR(COLOR_YELLOW));
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wprintw(wLog, ".\n");
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            break;
+          case fnLog::Text:
+            uiT(l.T);
+            wattron(wLog, COLOR_PAIR(COLOR_WHITE));
+            wattron(wLog, A_BOLD);
+            wprintw(wLog, k.data());
+            wattroff(wLog, A_BOLD);
+            wprintw(wLog, string(" ").append(s).append(".\n").data());
+            wattroff(wLog, COLOR_PAIR(COLOR_WHITE));
+            break;
+          case fnLog::Raw:
+            if (l.b) wattron(wLog, A_BOLD);
+            wattron(wLog, COLOR_PAIR(l.c));
+            wprintw(wLog, k.data());
+            wattroff(wLog, COLOR_PAIR(l.c));
+            if (l.b) wattroff(wLog, A_BOLD);
+            break;
+        }
+      };
+      static void screen_render() {
+        vector<string> rows;
+        int p = 0, spin = 0;
+        while (true) {
+          {
+            unique_lock<mutex> lock(wMutex);
+            wCond.wait_for(lock, chrono::milliseconds(100), []() { return wDirty or wResize or !wInit; });
+            if (!wInit) return;
+            bool full = wResize.exchange(false) and screen_size();
+            if (!wDirty.exchange(false) and !full) continue;
+            screen_draw(rows, p, spin, full);
+          }
+          this_thread::sleep_for(chrono::milliseconds(100));
+        }
+      };
+      static bool screen_size() {
+        struct winsize ws;
+        if (ioctl(0, TIOCGWINSZ, &ws) < 0 or (ws.ws_row == getmaxy(wBorder) and ws.ws_col == getmaxx(wBorder)))
+          return false;
         if (ws.ws_row < 10) ws.ws_row = 10;
         if (ws.ws_col < 20) ws.ws_col = 20;
         wresize(wBorder, ws.ws_row, ws.ws_col);
         resizeterm(ws.ws_row, ws.ws_col);
-        wMutex.unlock();
-        screen_refresh();
-        lock_guard<mutex> lock(wMutex);
         redrawwin(wLog);
-        wrefresh(wLog);
+        return true;
+      };
+      static void screen_draw(vector<string> &rows, int &p, int &spin, bool full) {
+        int y = getmaxy(wBorder),
+            x = getmaxx(wBorder),
+            k = y - wOrders.size() - 1,
+            P = k;
+        vector<string> rows_;
+        for (vector<mOrder>::iterator it = wOrders.begin(); it != wOrders.end(); ++it) {
+          stringstream ss;
+          ss << setprecision(8) << fixed << (it->side == mSide::Bid ? "BID" : "ASK") << " > " << it->orderId << ": " << it->quantity << " " << it->pair.base << " at price " << it->price << " " << it->pair.quote;
+          rows_.push_back(ss.str());
+        }
+        if (k != p or rows.size() != rows_.size()) full = true;
+        if (full) {
+          int l = p;
+          while (l<y) mvwhline(wBorder, l++, 1, ' ', x-1);
+          if (k!=p) {
+            if (k<p) wscrl(wLog, p-k);
+            wresize(wLog, k-3, x-2);
+            if (k>p) wscrl(wLog, p-k);
+            p = k;
+          }
+          mvwvline(wBorder, 1, 1, ' ', y-1);
+          mvwvline(wBorder, k-1, 1, ' ', y-1);
+        }
+        for (size_t i = 0; i < rows_.size(); ++i) {
+          ++P;
+          if (!full and rows[i] == rows_[i]) continue;
+          if (!full) mvwhline(wBorder, P, 1, ' ', x-1);
+          bool bid = rows_[i][0] == 'B';
+          wattron(wBorder, COLOR_PAIR(bid ? COLOR_CYAN : COLOR_MAGENTA));
+          mvwaddstr(wBorder, P, 1, rows_[i].data());
+          wattroff(wBorder, COLOR_PAIR(bid ? COLOR_CYAN : COLOR_MAGENTA));
+        }
+        rows.swap(rows_);
+        if (full) {
+          mvwaddch(wBorder, 0, 0, ACS_ULCORNER);
+          mvwhline(wBorder, 0, 1, ACS_HLINE, max(80, x));
+          mvwvline(wBorder, 1, 0, ACS_VLINE, k);
+          mvwvline(wBorder, k, 0, ACS_LTEE, y);
+          mvwaddch(wBorder, y, 0, ACS_BTEE);
+          mvwaddch(wBorder, 0, 12, ACS_RTEE);
+          wattron(wBorder, COLOR_PAIR(COLOR_GREEN));
+          mvwaddstr(wBorder, 0, 13, (string("   ") + K_BUILD + " " + K_STAMP + " ").data());
+          mvwaddch(wBorder, 0, 14, 'K' | A_BOLD);
+          wattroff(wBorder, COLOR_PAIR(COLOR_GREEN));
+          mvwaddch(wBorder, 0, 18+string(K_BUILD).length()+string(K_STAMP).length(), ACS_LTEE);
+          mvwaddch(wBorder, 0, x-12, ACS_RTEE);
+          mvwaddstr(wBorder, 0, x-11, " [ ]: Quit!");
+          mvwaddch(wBorder, 0, x-9, 'q' | A_BOLD);
+          mvwaddch(wBorder, 0, 7, ACS_TTEE);
+          mvwaddch(wBorder, 1, 7, ACS_LLCORNER);
+          mvwhline(wBorder, 1, 8, ACS_HLINE, 4);
+          mvwaddch(wBorder, 1, 12, ACS_RTEE);
+          wattron(wBorder, COLOR_PAIR(COLOR_GREEN));
+          wattron(wBorder, A_BOLD);
+          mvwaddstr(wBorder, 1, 14, (argExchange + " " + argCurrency).data());
+          wattroff(wBorder, A_BOLD);
+          waddstr(wBorder, (argHeadless ? " headless" : " UI on " + uiPrtcl + " port " + to_string(argPort)).data());
+          wattroff(wBorder, COLOR_PAIR(COLOR_GREEN));
+          mvwaddch(wBorder, k, 0, ACS_LTEE);
+          mvwhline(wBorder, k, 1, ACS_HLINE, 3);
+          mvwaddch(wBorder, k, 4, ACS_RTEE);
+          mvwaddstr(wBorder, k, 5, "< (");
+          wattron(wBorder, COLOR_PAIR(COLOR_YELLOW));
+          waddstr(wBorder, to_string(wOrders.size()).data());
+          wattroff(wBorder, COLOR_PAIR(COLOR_YELLOW));
+          waddstr(wBorder, ") Open Orders..");
+          mvwaddch(wBorder, y-1, 0, ACS_LLCORNER);
+        }
+        mvwaddstr(wBorder, y-1, x-1, string("|/-\\").substr(++spin, 1).data());
+        if (spin==3) { spin = -1; }
+        move(k-1, 2);
+        wrefresh(wBorder);
+        if (full) wrefresh(wLog);
       };
   };
 }
@@ -12,18 +12,6 @@ namespace K {
       static void main() {
         evExit = happyEnding;
         if (argAutobot) gwAutoStart = mConnectivity::Connected;
-        thread([&]() {
-          unsigned int T_5m = 0;
-          while (true) {
-            if (argDebugEvents) FN::log("DEBUG", "EV GW cancel thread.");
-            if (QP::getBool("cancelOrdersAuto") and ++T_5m == 20) {
-              T_5m = 0;
-              gW->cancelAll();
-            }
-            gw->wallet();
-            this_thread::sleep_for(chrono::seconds(15));
-          }
-        }).detach();
         ev_gwConnectOrder = [](mConnectivity k) {
           _gwCon_(mGatewayType::OrderEntry, k);
         };
@@ -32,6 +20,11 @@ namespace K {
           if (k == mConnectivity::Disconnected)
             ev_gwDataLevels(mLevels());
         };
+        EN::main();
+        if (argReplay == "") {
+          TM::once(0, &poll, false);
+          TM::every(15e+6, &poll, false);
+        }
         UI::uiSnap(uiTXT::ProductAdvertisement, &onSnapProduct);
         UI::uiSnap(uiTXT::ExchangeConnectivity, &onSnapStatus);
         UI::uiSnap(uiTXT::ActiveState, &onSnapState);
@@ -44,32 +37,28 @@ namespace K {
         }
       };
       static void gwBookUp(mConnectivity k) {
-    	  FN::log("DEBUG", "gwBookUp");
         ev_gwConnectMarket(k);
       };
       static void gwOrderUp(mConnectivity k) {
-    	  FN::log("DEBUG", "gwOrderup[connect]");
         ev_gwConnectOrder(k);
       };
       static void gwPosUp(mWallet k) {
-    	  FN::log("DEBUG", "gwPosUP");
         ev_gwDataWallet(k);
       };
       static void gwOrderUp(mOrder k) {
-    	  FN::log("DEBUG", "gworderup[data]");
         ev_gwDataOrder(k);
       };
       static void gwTradeUp(mTrade k) {
-    	  FN::log("DEBUG", "gwTradeup");
         ev_gwDataTrade(k);
       };
       static void gwLevelUp(mLevels k) {
-    	  FN::log("DEBUG", "gwlevelup");
         ev_gwDataLevels(k);
       };
+      static void gwLevelUp(mSide s, mLevel k, unsigned long seq) {
+        ev_gwDataLevel(s, k, seq);
+      };
     private:
       static json onSnapProduct() {
-    	  FN::log("DEBUG", "onsnapproducts");
         return {{
           {"exchange", (int)gw->exchange},
           {"pair", {{"base", gw->base}, {"quote", gw->quote}}},
@@ -80,15 +69,12 @@ namespace K {
         }};
       };
       static json onSnapStatus() {
-    	  FN::log("DEBUG", "onsnapstatus");
         return {{{"status", (int)gwConnectExchange}}};
       };
       static json onSnapState() {
-    	  FN::log("DEBUG", "onsnapstate.");
         return {{{"state",  (int)gwQuotingState}}};
       };
       static void onHandState(json k) {
-    	  FN::log("DEBUG", "onhandstate");
         if (!k.is_object() or !k["state"].is_number()) {
           FN::logWar("JSON", "Missing state at onHandState, ignored");
           return;
@@ -99,8 +85,21 @@ namespace K {
           gwUpState();
         }
       };
+      static void poll() { // blocking REST calls stay off the timer wheel thread, one poll at a time
+        static atomic<bool> polling(false);
+        if (polling.exchange(true)) return;
+        thread([]() {
+          static unsigned int T_5m = 0;
+          if (argDebugEvents) FN::log("DEBUG", "EV GW poll timer");
+          if (QP::get().cancelOrdersAuto and ++T_5m == 20) {
+            T_5m = 0;
+            gW->cancelAll();
+          }
+          gw->wallet();
+          polling = false;
+        }).detach();
+      };
       static void _gwCon_(mGatewayType gwT, mConnectivity gwS) {
-    	  FN::log("DEBUG", "gwcon");
         if (gwT == mGatewayType::MarketData) {
           if (gwConnectMarket == gwS) return;
           gwConnectMarket = gwS;
@@ -114,7 +113,6 @@ namespace K {
         UI::uiSend(uiTXT::ExchangeConnectivity, {{"status", (int)gwConnectExchange}});
       };
       static void gwUpState() {
-    	  FN::log("DEBUG", "gwupstate");
         mConnectivity quotingState = gwConnectExchange;
         if (quotingState == mConnectivity::Connected) quotingState = gwAutoStart;
         if (quotingState != gwQuotingState) {
@@ -130,9 +128,205 @@ namespace K {
         FN::log(string("GW ") + argExchange, "Attempting to cancel all open orders, please wait.");
         gW->cancelAll();
         FN::log(string("GW ") + argExchange, "cancell all open orders OK");
+        DB::flush();
+        JN::flush();
         EV::end(code);
       };
   };
+  class GwPeatio: public Gw {
+    public:
+      mExchange config() {
+        exchange = mExchange::Peatio;
+        symbol = FN::S2l(base + quote);
+        cancelByLocalIds = false;
+        supportCancelAll = true;
+        return exchange;
+      };
+      string randId() {
+        return FN::uid();
+      };
+      void wallet() {
+        json k = wJet("GET", "/api/v2/members/me", {});
+        if (!reach(k)) return;
+        if (!k.is_object() or !k["accounts"].is_array()) return;
+        for (json::iterator it = k["accounts"].begin(); it != k["accounts"].end(); ++it) {
+          string currency = FN::S2u(it->value("currency", ""));
+          if (currency != base and currency != quote) continue;
+          GW::gwPosUp(mWallet(
+            stod(it->value("balance", "0")),
+            stod(it->value("locked", "0")),
+            currency
+          ));
+        }
+      };
+      void levels() {
+        mConnectivity connected = mConnectivity::Disconnected;
+        while (open) {
+          string k = wGet("GET", "/api/v2/depth", {{"market", symbol}, {"limit", "50"}}, false);
+          mLevels levels;
+          bool book = FN::book(k.data(), k.length(), levels);
+          if (!book) {
+            json k_ = json::parse(FN::wJson(k));
+            if ((book = k_.is_object() and k_["bids"].is_array() and k_["asks"].is_array()))
+              levels = mLevels(depth(k_["bids"]), depth(k_["asks"]));
+          }
+          mConnectivity connected_ = book ? mConnectivity::Connected : mConnectivity::Disconnected;
+          if (connected != connected_) {
+            connected = connected_;
+            GW::gwBookUp(connected);
+          }
+          if (connected == mConnectivity::Connected) {
+            sort(levels.bids.begin(), levels.bids.end(), [](const mLevel &a, const mLevel &b) { return a.price > b.price; });
+            sort(levels.asks.begin(), levels.asks.end(), [](const mLevel &a, const mLevel &b) { return a.price < b.price; });
+            GW::gwLevelUp(levels);
+            orders();
+          }
+          this_thread::sleep_for(chrono::milliseconds(wPoll));
+        }
+      };
+      void send(string oI, mSide oS, double oP, double oQ, mOrderType oLM, mTimeInForce oTIF, bool oPO, unsigned long oT) {
+        wAsync("POST", "/api/v2/orders", {
+          {"market", symbol},
+          {"side", oS == mSide::Bid ? "buy" : "sell"},
+          {"volume", decimal(oQ)},
+          {"price", decimal(oP)},
+          {"ord_type", oLM == mOrderType::Limit ? "limit" : "market"}
+        }, [this, oI, oP, oQ](json k) {
+          if (!reach(k) or !k.is_object() or !k["id"].is_number()) {
+            FN::logWar(string("GW ") + name, string("Unable to place order ") + oI + ": " + k.dump());
+            GW::gwOrderUp(mOrder(oI, mORS::Cancelled));
+            return;
+          }
+          string oE = to_string(k["id"].get<unsigned long>());
+          wOrdersMutex.lock();
+          wOrdersDone[oE] = 0;
+          wOrdersMutex.unlock();
+          GW::gwOrderUp(mOrder(oI, oE, mORS::Working, oP, oQ, 0));
+          order(k);
+        });
+      };
+      void cancel(string oI, string oE, mSide oS, unsigned long oT) {
+        wAsync("POST", "/api/v2/order/delete", {{"id", oE}}, [this](json k) {
+          if (reach(k) and k.is_object() and k.value("state", "") == "cancel") order(k);
+        });
+      };
+      void cancelAll() {
+        reach(wJet("POST", "/api/v2/orders/clear", {}));
+      };
+      void freeSockets() {
+        open = false;
+      };
+    private:
+      friend class UT;
+      map<string, double> wOrdersDone;
+      mutex wOrdersMutex;
+      unsigned long wTonce = 0;
+      unsigned int wPoll = 500;
+      mConnectivity wConnected = mConnectivity::Disconnected;
+      atomic<bool> open{true};
+      void orders() {
+        wOrdersMutex.lock();
+        bool pending = !wOrdersDone.empty();
+        wOrdersMutex.unlock();
+        if (!pending) return;
+        json k = wJet("GET", "/api/v2/orders", {{"market", symbol}, {"state", "wait"}, {"limit", "1000"}});
+        if (!reach(k) or !k.is_array()) return;
+        map<string, void*> waiting;
+        for (json::iterator it = k.begin(); it != k.end(); ++it) {
+          if (!(*it)["id"].is_number()) continue;
+          waiting[to_string((*it)["id"].get<unsigned long>())] = nullptr;
+          order(*it);
+        }
+        vector<string> gone;
+        wOrdersMutex.lock();
+        for (map<string, double>::iterator it = wOrdersDone.begin(); it != wOrdersDone.end(); ++it)
+          if (waiting.find(it->first) == waiting.end()) gone.push_back(it->first);
+        wOrdersMutex.unlock();
+        for (vector<string>::iterator it = gone.begin(); it != gone.end(); ++it) {
+          json o = wJet("GET", "/api/v2/order", {{"id", *it}});
+          if (o.is_object()) order(o);
+        }
+      };
+      void order(json k) {
+        if (!k["id"].is_number()) return;
+        string oE = to_string(k["id"].get<unsigned long>());
+        string state = k.value("state", "");
+        double executed = stod(k.value("executed_volume", "0"));
+        wOrdersMutex.lock();
+        map<string, double>::iterator it = wOrdersDone.find(oE);
+        if (it == wOrdersDone.end()) {
+          wOrdersMutex.unlock();
+          return;
+        }
+        double lastQuantity = executed - it->second;
+        it->second = executed;
+        if (state == "done" or state == "cancel") wOrdersDone.erase(it);
+        wOrdersMutex.unlock();
+        mORS status = state == "done"
+          ? mORS::Complete : (state == "cancel" ? mORS::Cancelled : mORS::Working);
+        if (lastQuantity < minSize / 2 and status == mORS::Working) return;
+        GW::gwOrderUp(mOrder("", oE, status, stod(k.value("price", "0")), stod(k.value("volume", "0")), lastQuantity > 0 ? lastQuantity : 0));
+      };
+      bool reach(const json &k) { // order entry is up while the signed calls get an authorized answer
+        json::const_iterator e = k.is_object() ? k.find("error") : k.end();
+        int code = e != k.end() and e->is_object() ? e->value("code", 0) : 0;
+        mConnectivity connected = k.is_null() or (k.is_object() and k.empty()) or code == 2001 or code == 2005 or code == 2008
+          ? mConnectivity::Disconnected : mConnectivity::Connected;
+        wOrdersMutex.lock();
+        bool changed = wConnected != connected;
+        wConnected = connected;
+        wOrdersMutex.unlock();
+        if (changed) GW::gwOrderUp(connected);
+        return connected == mConnectivity::Connected;
+      };
+      vector<mLevel> depth(json k) {
+        vector<mLevel> levels;
+        for (json::iterator it = k.begin(); it != k.end(); ++it)
+          if (it->is_array() and it->size() > 1)
+            levels.push_back(mLevel(stod(it->at(0).get<string>()), stod(it->at(1).get<string>())));
+        return levels;
+      };
+      string decimal(double k) {
+        stringstream ss;
+        ss << setprecision(8) << fixed << k;
+        return ss.str();
+      };
+      string query(string method, string path, map<string, string> params, bool sign) {
+        if (sign) {
+          params["access_key"] = apikey;
+          wOrdersMutex.lock();
+          wTonce = max(FN::T(), wTonce + 1);
+          params["tonce"] = to_string(wTonce);
+          wOrdersMutex.unlock();
+        }
+        string k;
+        for (map<string, string>::iterator it = params.begin(); it != params.end(); ++it)
+          k.append(k.empty() ? "" : "&").append(it->first).append("=").append(it->second);
+        if (sign) k.append("&signature=").append(FN::oHmac256(method + "|" + path + "|" + k, secret, true));
+        return k;
+      };
+      json wJet(string method, string path, map<string, string> params, bool sign = true) {
+        return json::parse(FN::wJson(wGet(method, path, params, sign)));
+      };
+      string wGet(string method, string path, map<string, string> params, bool sign = true) {
+        string k = query(method, path, params, sign);
+        return method == "POST"
+          ? FN::wSync(method, string(http).append(path), k, {})
+          : FN::wSync(method, string(http).append(path).append("?").append(k), "", {});
+      };
+      void wAsync(string method, string path, map<string, string> params, function<void(json)> cb) {
+        string k = query(method, path, params, true);
+        function<void(string)> cb_ = [cb](string k) { cb(json::parse(FN::wJson(k))); };
+        if (method == "POST") FN::wAsync(method, string(http).append(path), k, {}, cb_);
+        else FN::wAsync(method, string(http).append(path).append("?").append(k), "", {}, cb_);
+      };
+  };
+  static Gw *gwE(mExchange e) {
+    if (argReplay != "") return new GwReplay();
+    if (e == mExchange::Peatio) return new GwPeatio();
+    if (e == mExchange::Sim) return new GwSim();
+    return Gw::E(e);
+  };
 }
 
 #endif
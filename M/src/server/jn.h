@@ -0,0 +1,285 @@
+#ifndef K_JN_H_
+#define K_JN_H_
+
+namespace K {
+  static ofstream jnFile;
+  static mutex jnMutex;
+  static evLevels jnLevels;
+  static evLevel jnLevel;
+  static evTrade jnTrade;
+  static evOrder jnOrder;
+  static evWallet jnWallet;
+  static const char jnMagic[] = "KJN1";
+  class JN {
+    public:
+      static void main() {
+        if (argRecord == "") return;
+        jnFile.open(argRecord, ios::binary | ios::trunc);
+        if (!jnFile.is_open()) { FN::logErr("JN", string("Unable to open journal ") + argRecord); exit(EXIT_FAILURE); }
+        jnFile.write(jnMagic, 4);
+        put(argExchange);
+        put(gw->base);
+        put(gw->quote);
+        put(gw->minTick);
+        put(gw->minSize);
+        jnLevels = ev_gwDataLevels;
+        jnLevel = ev_gwDataLevel;
+        jnTrade = ev_gwDataTrade;
+        jnOrder = ev_gwDataOrder;
+        jnWallet = ev_gwDataWallet;
+        ev_gwDataLevels = [](mLevels k) {
+          record(k);
+          jnLevels(k);
+        };
+        ev_gwDataLevel = [](mSide s, mLevel k, unsigned long seq) {
+          record(s, k, seq);
+          jnLevel(s, k, seq);
+        };
+        ev_gwDataTrade = [](mTrade k) {
+          record(k);
+          jnTrade(k);
+        };
+        ev_gwDataOrder = [](mOrder k) {
+          record(k);
+          jnOrder(k);
+        };
+        ev_gwDataWallet = [](mWallet k) {
+          record(k);
+          jnWallet(k);
+        };
+        FN::log("JN", string("recording market data to ") + argRecord);
+      };
+      static void flush() {
+        if (!jnFile.is_open()) return;
+        lock_guard<mutex> lock(jnMutex);
+        jnFile.flush();
+      };
+    private:
+      template <typename T> static void put(T k) {
+        jnFile.write((char*)&k, sizeof(T));
+      };
+      static void put(string k) {
+        put((unsigned short)k.length());
+        jnFile.write(k.data(), k.length());
+      };
+      static void put(char k, unsigned long t) {
+        put(k);
+        put(t);
+      };
+      static void record(const mLevels &k) {
+        lock_guard<mutex> lock(jnMutex);
+        put('L', FN::T());
+        put((unsigned int)k.bids.size());
+        put((unsigned int)k.asks.size());
+        for (vector<mLevel>::const_iterator it = k.bids.begin(); it != k.bids.end(); ++it) {
+          put(it->price);
+          put(it->size);
+        }
+        for (vector<mLevel>::const_iterator it = k.asks.begin(); it != k.asks.end(); ++it) {
+          put(it->price);
+          put(it->size);
+        }
+      };
+      static void record(mSide s, const mLevel &k, unsigned long seq) {
+        lock_guard<mutex> lock(jnMutex);
+        put('l', FN::T());
+        put((unsigned char)s);
+        put(k.price);
+        put(k.size);
+        put(seq);
+      };
+      static void record(const mTrade &k) {
+        lock_guard<mutex> lock(jnMutex);
+        put('t', FN::T());
+        put((unsigned char)k.side);
+        put(k.price);
+        put(k.quantity);
+      };
+      static void record(const mOrder &k) {
+        lock_guard<mutex> lock(jnMutex);
+        put('o', FN::T());
+        put(k.orderId);
+        put(k.exchangeId);
+        put((unsigned char)k.orderStatus);
+        put((unsigned char)k.side);
+        put(k.price);
+        put(k.quantity);
+        put(k.lastQuantity);
+      };
+      static void record(const mWallet &k) {
+        lock_guard<mutex> lock(jnMutex);
+        put('w', FN::T());
+        put(k.currency);
+        put(k.amount);
+        put(k.held);
+      };
+  };
+  struct jnRecord {
+             char type;
+    unsigned long T,
+                  seq;
+          mLevels levels;
+            mSide side;
+           mLevel level;
+           mTrade trade;
+           mOrder order;
+          mWallet wallet;
+  };
+  class GwReplay: public GwSim {
+    public:
+      GwReplay() {
+        jn.open(argReplay, ios::binary);
+        char magic[4];
+        if (!jn.is_open() or !jn.read(magic, 4) or strncmp(magic, jnMagic, 4)) {
+          FN::logErr("JN", string("Unable to read journal ") + argReplay);
+          exit(EXIT_FAILURE);
+        }
+        string exchange = get<string>();
+        base = get<string>();
+        quote = get<string>();
+        minTick = get<double>();
+        minSize = get<double>();
+        if (!jn) {
+          FN::logErr("JN", string("Unable to read journal header of ") + argReplay);
+          exit(EXIT_FAILURE);
+        }
+        streampos first = jn.tellg();
+        jnRecord k;
+        if (read(k)) FN::T(k.T); // timers armed while booting count from the start of the journal
+        jn.clear();
+        jn.seekg(first);
+        argCurrency = base + "/" + quote;
+        trades = false;
+        FN::log("JN", string("replaying ") + exchange + " " + argCurrency + " from", argReplay);
+      };
+      mExchange config() {
+        exchange = mExchange::Null;
+        symbol = base + quote;
+        return exchange;
+      };
+      void levels() {
+        ev_gwConnectMarket(mConnectivity::Connected);
+        ev_gwConnectOrder(mConnectivity::Connected);
+        unsigned long T = FN::Tns(),
+                      T_1s = 0,
+                      t0 = 0,
+                      t = 0,
+                      n = 0;
+        map<string, double> recorded;
+        jnRecord k;
+        while (read(k)) {
+          t = k.T;
+          if (!t0) t0 = t;
+          if (!T_1s) T_1s = t + 1e+3;
+          for (; T_1s <= t; T_1s += 1e+3) {
+            TM::replay(T_1s);
+            FN::T(T_1s);
+            QE::stats();
+          }
+          TM::replay(t);
+          FN::T(t);
+          process();
+          if (k.type == 'L') {
+            clear();
+            for (vector<mLevel>::iterator it = k.levels.bids.begin(); it != k.levels.bids.end(); ++it)
+              GwSim::level(mSide::Bid, it->price, it->size);
+            for (vector<mLevel>::iterator it = k.levels.asks.begin(); it != k.levels.asks.end(); ++it)
+              GwSim::level(mSide::Ask, it->price, it->size);
+            publish();
+          } else if (k.type == 'l') {
+            GwSim::level(k.side, k.level.price, k.level.size);
+            publish();
+          } else if (k.type == 't') {
+            ev_gwDataTrade(k.trade);
+            add(smOrder("", k.trade.side, k.trade.price, k.trade.quantity), false);
+            publish();
+          } else if (k.type == 'o') {
+            if (k.order.lastQuantity > 0) { // fills of the recorded session moved its wallets, not ours
+              double sign = k.order.side == mSide::Bid ? 1 : -1;
+              recorded[base] += sign * k.order.lastQuantity;
+              recorded[quote] -= sign * k.order.lastQuantity * k.order.price;
+            }
+          } else if (k.type == 'w') {
+            string c = k.wallet.currency;
+            double amount = k.wallet.amount + k.wallet.held;
+            if (wallets.find(c) == wallets.end()) wallets[c] = amount;
+            else if (fabs(amount - recorded[c]) > minSize * 1e-3) // what fills do not explain was moved in or out of the account
+              wallets[c] += amount - recorded[c];
+            else {
+              recorded[c] = amount;
+              ++n;
+              continue;
+            }
+            recorded[c] = amount;
+            ev_gwDataWallet(mWallet(wallets[c], 0, c));
+          } else {
+            FN::logErr("JN", string("Corrupted journal record at event ") + to_string(n));
+            break;
+          }
+          ++n;
+        }
+        if (!jn.eof()) FN::logErr("JN", string("Truncated journal record at event ") + to_string(n));
+        T = FN::Tns() - T;
+        FN::log("JN", string("replayed ") + to_string(n) + " events of " + to_string((t - t0) / 6e+4) + " minutes in " + to_string(T / 1e+6) + "ms (" + to_string(T ? (unsigned long)(n * 1e+9 / T) : 0) + " events/s), "
+          + to_string(sent) + " orders sent, " + to_string(fills) + " fills, "
+          + base + " " + to_string(wallets[base]) + ", " + quote + " " + to_string(wallets[quote]));
+        evExit(EXIT_SUCCESS);
+      };
+    private:
+      friend class UT;
+      ifstream jn;
+      template <typename T> T get() {
+        T k;
+        get(k);
+        return k;
+      };
+      template <typename T> void get(T &k) {
+        jn.read((char*)&k, sizeof(T));
+      };
+      void get(string &k) {
+        unsigned short n = get<unsigned short>();
+        k.resize(jn ? n : 0);
+        jn.read(&k[0], k.length());
+      };
+      mLevel level() {
+        double p = get<double>();
+        return mLevel(p, get<double>());
+      };
+      bool read(jnRecord &k) {
+        if (!jn.read(&k.type, 1)) return false;
+        k.T = get<unsigned long>();
+        if (k.type == 'L') {
+          unsigned int b = get<unsigned int>(),
+                       a = get<unsigned int>();
+          if (!jn) return false;
+          k.levels.bids.clear();
+          k.levels.asks.clear();
+          for (unsigned int i = 0; i < b and jn; ++i) k.levels.bids.push_back(level());
+          for (unsigned int i = 0; i < a and jn; ++i) k.levels.asks.push_back(level());
+        } else if (k.type == 'l') {
+          k.side = (mSide)get<unsigned char>();
+          k.level = level();
+          k.seq = get<unsigned long>();
+        } else if (k.type == 't') {
+          k.trade.side = (mSide)get<unsigned char>();
+          k.trade.price = get<double>();
+          k.trade.quantity = get<double>();
+        } else if (k.type == 'o') {
+          k.order.orderId = get<string>();
+          k.order.exchangeId = get<string>();
+          k.order.orderStatus = (mORS)get<unsigned char>();
+          k.order.side = (mSide)get<unsigned char>();
+          k.order.price = get<double>();
+          k.order.quantity = get<double>();
+          k.order.lastQuantity = get<double>();
+        } else if (k.type == 'w') {
+          k.wallet.currency = get<string>();
+          k.wallet.amount = get<double>();
+          k.wallet.held = get<double>();
+        }
+        return (bool)jn;
+      };
+  };
+}
+
+#endif
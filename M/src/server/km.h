@@ -2,6 +2,8 @@
 #define K_KM_H_
 
 namespace K {
+  class BM; // test/benchmark.cc drives private hot paths of the engine
+  class UT; // test/units.cc reads private state of the modules it checks
   static const char alphanum[] = "0123456789"
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz";
@@ -13,7 +15,11 @@ namespace K {
              argDebugQuotes = 0,
              argHeadless = 0,
              argNaked = 0,
-             argAutobot = 0;
+             argAutobot = 0,
+             argSimLatency = 0,
+             argSimRate = 0,
+             argEngineCpu = -1,
+             argHttpTimeout = 10000;
   extern int argFree;
   static string argTitle = "K.sh",
                 argExchange = "NULL",
@@ -21,6 +27,10 @@ namespace K {
                 argPass = "NULL",
                 argMatryoshka = "https://www.example.com/",
                 argDatabase = "",
+                argDbSync = "NORMAL",
+                argRecord = "",
+                argReplay = "",
+                argLogFile = "",
                 argCurrency = "NULL",
                 argTarget = "NULL",
                 argApikey = "NULL",
@@ -33,7 +43,7 @@ namespace K {
   static double argEwmaShort = 0,
                 argEwmaMedium = 0,
                 argEwmaLong = 0;
-  enum class mExchange: unsigned int { Null, HitBtc, OkCoin, Coinbase, Bitfinex, Korbit, Poloniex };
+  enum class mExchange: unsigned int { Null, HitBtc, OkCoin, Coinbase, Bitfinex, Korbit, Poloniex, Peatio, Sim };
   enum class mGatewayType: unsigned int { MarketData, OrderEntry };
   enum class mTimeInForce: unsigned int { IOC, FOK, GTC };
   enum class mConnectivity: unsigned int { Disconnected, Connected };
@@ -49,6 +59,7 @@ namespace K {
   enum class mAPR: unsigned int { Off, Size, SizeWidth };
   enum class mSOP: unsigned int { Off, x2trades, x3trades, x2Size, x3Size, x2tradesSize, x3tradesSize };
   enum class mSTDEV: unsigned int { Off, OnFV, OnFVAPROff, OnTops, OnTopsAPROff, OnTop, OnTopAPROff };
+  enum class mLatency: unsigned int { Filter, FairValue, Quote, Send, Ack, Fill, TickToTrade, Http };
   enum class uiBIT: unsigned char { MSG = '-', SNAP = '=' };
   enum class uiTXT: unsigned char {
     FairValue = 'a', Quote = 'b', ActiveSubscription = 'c', ActiveState = 'd', MarketData = 'e',
@@ -58,7 +69,7 @@ namespace K {
     MarketTrade = 'r', Trades = 's', ExternalValuation = 't', QuoteStatus = 'u',
     TargetBasePosition = 'v', TradeSafetyValue = 'w', CancelAllOrders = 'x',
     CleanAllClosedOrders = 'y', CleanAllOrders = 'z', CleanTrade = 'A', TradesChart = 'B',
-    WalletChart = 'C', EWMAChart = 'D'
+    WalletChart = 'C', EWMAChart = 'D', Latency = 'E'
   };
   static char RBLACK[] = "\033[0;30m", RRED[]    = "\033[0;31m", RGREEN[] = "\033[0;32m", RYELLOW[] = "\033[0;33m",
               RBLUE[]  = "\033[0;34m", RPURPLE[] = "\033[0;35m", RCYAN[]  = "\033[0;36m", RWHITE[]  = "\033[0;37m",
@@ -311,6 +322,76 @@ namespace K {
       a.push_back({{"price", it->price}, {"size", it->size}});
     j = {{"bids", b}, {"asks", a}};
   };
+  struct mBook {
+    map<long, mLevel> bids, // keyed by -tick, so begin() is the best bid
+                      asks;
+    map<long, double> orders; // same signed tick, size of our own orders
+               double minTick;
+        unsigned long seq;
+                mutex ordersMutex;
+    mBook():
+      minTick(0), seq(0)
+    {};
+    long tick(mSide side, double price) const {
+      long k = minTick ? llround(price / minTick) : 0;
+      return side == mSide::Bid ? -k : k;
+    };
+    map<long, mLevel> &levels(mSide side) {
+      return side == mSide::Bid ? bids : asks;
+    };
+    bool update(mSide side, mLevel k, unsigned long s = 0) {
+      if (s) {
+        if (s <= seq) return true;
+        if (seq and s != seq + 1) return false;
+        seq = s;
+      }
+      if (k.size > 0) levels(side)[tick(side, k.price)] = k;
+      else levels(side).erase(tick(side, k.price));
+      return true;
+    };
+    void update(const mLevels &k, unsigned long s = 0) {
+      update(mSide::Bid, k.bids);
+      update(mSide::Ask, k.asks);
+      seq = s;
+    };
+    void update(mSide side, const vector<mLevel> &k) {
+      map<long, mLevel> &book = levels(side);
+      map<long, mLevel> next;
+      for (vector<mLevel>::const_iterator it = k.begin(); it != k.end(); ++it)
+        if (it->size > 0) next[tick(side, it->price)] = *it;
+      for (map<long, mLevel>::iterator it = book.begin(); it != book.end();)
+        if (next.find(it->first) == next.end()) it = book.erase(it);
+        else ++it;
+      for (map<long, mLevel>::iterator it = next.begin(); it != next.end(); ++it) {
+        map<long, mLevel>::iterator it_ = book.find(it->first);
+        if (it_ == book.end()) book.insert(*it);
+        else if (it_->second.size != it->second.size) it_->second = it->second;
+      }
+    };
+    void own(mSide side, double price, double size) {
+      lock_guard<mutex> lock(ordersMutex);
+      long k = tick(side, price);
+      if (abs(orders[k] += size) < 1e-10) orders.erase(k);
+    };
+    double size(long k, double size) {
+      lock_guard<mutex> lock(ordersMutex);
+      map<long, double>::iterator it = orders.find(k);
+      if (it == orders.end()) return size;
+      size -= it->second;
+      return size < minTick ? 0 : size;
+    };
+    mLevel top(mSide side, unsigned int n = 0) {
+      map<long, mLevel> &book = levels(side);
+      for (map<long, mLevel>::iterator it = book.begin(); it != book.end(); ++it) {
+        double k = size(it->first, it->second.size);
+        if (k and !n--) return mLevel(it->second.price, k);
+      }
+      return mLevel();
+    };
+    bool empty() {
+      return !top(mSide::Bid).price or !top(mSide::Ask).price;
+    };
+  };
   struct mQuote {
     mLevel bid,
            ask;
@@ -360,7 +441,131 @@ namespace K {
       {"quotesInMemoryDone", k.quotesInMemoryDone}
     };
   };
-  static map<string, mOrder> allOrders;
+  struct mQuotingParams {
+               double widthPing,
+                      widthPingPercentage,
+                      widthPong,
+                      widthPongPercentage;
+                 bool widthPercentage,
+                      bestWidth;
+               double buySize,
+                      buySizePercentage;
+                 bool buySizeMax;
+               double sellSize,
+                      sellSizePercentage;
+                 bool sellSizeMax;
+              mPingAt pingAt;
+              mPongAt pongAt;
+         mQuotingMode mode;
+         unsigned int bullets;
+               double range;
+      mFairValueModel fvModel;
+               double targetBasePosition,
+                      targetBasePositionPercentage,
+                      positionDivergence,
+                      positionDivergencePercentage;
+                 bool percentageValues;
+    mAutoPositionMode autoPositionMode;
+                 mAPR aggressivePositionRebalancing;
+                 mSOP superTrades;
+               double tradesPerMinute,
+                      tradeRateSeconds;
+                 bool quotingEwmaProtection;
+                  int quotingEwmaProtectionPeriods;
+               mSTDEV quotingStdevProtection;
+                 bool quotingStdevBollingerBands;
+               double quotingStdevProtectionFactor;
+                  int quotingStdevProtectionPeriods;
+               double ewmaSensiblityPercentage;
+                  int longEwmaPeriods,
+                      mediumEwmaPeriods,
+                      shortEwmaPeriods,
+                      aprMultiplier,
+                      sopWidthMultiplier;
+               double delayAPI;
+                 bool cancelOrdersAuto;
+               double cleanPongsAuto,
+                      profitHourInterval;
+                 bool audio;
+               double delayUI;
+  };
+  struct mRollingStat {
+    vector<double> ring;
+            size_t head,
+                   len;
+            double mean,
+                   m2;
+    mRollingStat():
+      head(0), len(0), mean(0), m2(0)
+    {};
+    size_t size() const {
+      return len;
+    };
+    double stdev() const {
+      return len ? sqrt(m2 / len) : 0;
+    };
+    void push_back(double x) {
+      if (ring.empty()) return;
+      if (len < ring.size()) {
+        ring[(head + len++) % ring.size()] = x;
+        double d = x - mean;
+        mean += d / len;
+        m2 += d * (x - mean);
+      } else {
+        double y = ring[head],
+               mean_ = mean;
+        ring[head] = x;
+        head = (head + 1) % ring.size();
+        mean += (x - y) / len;
+        m2 += (x - y) * (x - mean + y - mean_);
+        if (!head) recalc(); // exact pass once per lap bounds the drift
+      }
+      if (m2 < 0) m2 = 0;
+    };
+    void resize(size_t n) {
+      if (n == ring.size()) return;
+      vector<double> k;
+      for (size_t i = len > n ? len - n : 0; i < len; ++i)
+        k.push_back(ring[(head + i) % ring.size()]);
+      ring.assign(n, 0);
+      copy(k.begin(), k.end(), ring.begin());
+      head = 0;
+      len = k.size();
+      recalc();
+    };
+    private:
+      void recalc() {
+        mean = m2 = 0;
+        if (!len) return;
+        for (size_t i = 0; i < len; ++i) mean += ring[i];
+        mean /= len;
+        for (size_t i = 0; i < len; ++i) m2 += (ring[i] - mean) * (ring[i] - mean);
+      };
+  };
+  struct mHistogram {
+    static const unsigned int size = 1184; // 32 linear buckets per power of two up to 2^40ns (~3% error)
+    atomic<unsigned long> n[size];
+    mHistogram() {
+      for (unsigned int i = 0; i < size; ++i) n[i] = 0;
+    };
+    void record(unsigned long v) {
+      unsigned int i = index(v);
+      n[i].store(n[i].load(memory_order_relaxed) + 1, memory_order_relaxed); // single writer per thread
+    };
+    static unsigned int index(unsigned long v) {
+      if (v < 32) return v;
+      if (v >> 41) v = (1UL << 41) - 1;
+      unsigned int m = 63 - __builtin_clzl(v);
+      return (m - 4) * 32 + ((v >> (m - 5)) & 31);
+    };
+    static unsigned long value(unsigned int i) {
+      if (i < 32) return i;
+      unsigned int m = i / 32 + 4;
+      return ((33UL + i % 32) << (m - 5)) - 1;
+    };
+  };
+  static unordered_map<string, mOrder> allOrders;
+  static mBook mgBook;
 }
 
 #endif
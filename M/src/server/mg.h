@@ -3,7 +3,6 @@
 
 namespace K {
   int mgT = 0;
-  mLevels mgLevelsFilter;
   vector<mTrade> mgTrades;
   double mgFairValue = 0;
   double mgEwmaL = 0;
@@ -11,10 +10,10 @@ namespace K {
   double mgEwmaS = 0;
   double mgEwmaP = 0;
   vector<double> mgSMA3;
-  vector<double> mgStatFV;
-  vector<double> mgStatBid;
-  vector<double> mgStatAsk;
-  vector<double> mgStatTop;
+  mRollingStat mgStatFV;
+  mRollingStat mgStatBid;
+  mRollingStat mgStatAsk;
+  mRollingStat mgStatTop;
   double mgStdevFV = 0;
   double mgStdevFVMean = 0;
   double mgStdevBid = 0;
@@ -27,6 +26,7 @@ namespace K {
   class MG {
     public:
       static void main() {
+        mgBook.minTick = gw->minTick;
         load();
         ev_gwDataTrade = [](mTrade k) {
           if (argDebugEvents) FN::log("DEBUG", "EV MG ev_gwDataTrade");
@@ -36,12 +36,16 @@ namespace K {
           if (argDebugEvents) FN::log("DEBUG", "EV MG ev_gwDataLevels");
           levelUp(k);
         };
+        ev_gwDataLevel = [](mSide s, mLevel k, unsigned long seq) {
+          if (argDebugEvents) FN::log("DEBUG", "EV MG ev_gwDataLevel");
+          levelUp(s, k, seq);
+        };
         UI::uiSnap(uiTXT::MarketTrade, &onSnapTrade);
         UI::uiSnap(uiTXT::FairValue, &onSnapFair);
         UI::uiSnap(uiTXT::EWMAChart, &onSnapEwma);
       };
       static bool empty() {
-        return (!mgLevelsFilter.bids.size() or !mgLevelsFilter.asks.size());
+        return mgBook.empty();
       };
       static void calcStats() {
         if (++mgT == 60) {
@@ -54,27 +58,32 @@ namespace K {
       static void calcFairValue() {
         if (empty()) return;
         double mgFairValue_ = mgFairValue;
-        double topAskPrice = mgLevelsFilter.asks.begin()->price;
-        double topBidPrice = mgLevelsFilter.bids.begin()->price;
-        double topAskSize = mgLevelsFilter.asks.begin()->size;
-        double topBidSize = mgLevelsFilter.bids.begin()->size;
+        mLevel topAsk = mgBook.top(mSide::Ask);
+        mLevel topBid = mgBook.top(mSide::Bid);
+        double topAskPrice = topAsk.price;
+        double topBidPrice = topBid.price;
+        double topAskSize = topAsk.size;
+        double topBidSize = topBid.size;
         if (!topAskPrice or !topBidPrice or !topAskSize or !topBidSize) return;
         mgFairValue = FN::roundNearest(
-          mFairValueModel::BBO == (mFairValueModel)QP::getInt("fvModel")
+          mFairValueModel::BBO == QP::get().fvModel
             ? (topAskPrice + topBidPrice) / 2
             : (topAskPrice * topAskSize + topBidPrice * topBidSize) / (topAskSize + topBidSize),
           gw->minTick
         );
         if (!mgFairValue or (mgFairValue_ and abs(mgFairValue - mgFairValue_) < gw->minTick)) return;
         ev_gwDataWallet(mWallet());
-        UI::uiSend(uiTXT::FairValue, {{"price", mgFairValue}}, true);
+        UI::uiSend(uiTXT::FairValue, []() -> json { return {{"price", mgFairValue}}; }, true);
       };
     private:
+      friend class BM;
       static void load() {
+        const mQuotingParams &qp = QP::get();
+        cleanStdev();
         json k = DB::load(uiTXT::MarketData);
         if (k.size()) {
           for (json::iterator it = k.begin(); it != k.end(); ++it) {
-            if (it->value("time", (unsigned long)0)+QP::getInt("quotingStdevProtectionPeriods")*1e+3<FN::T()) continue;
+            if (it->value("time", (unsigned long)0)+qp.quotingStdevProtectionPeriods*1e+3<FN::T()) continue;
             mgStatFV.push_back(it->value("fv", 0.0));
             mgStatBid.push_back(it->value("bid", 0.0));
             mgStatAsk.push_back(it->value("ask", 0.0));
@@ -90,11 +99,11 @@ namespace K {
         k = DB::load(uiTXT::EWMAChart);
         if (k.size()) {
           k = k.at(0);
-          if (!mgEwmaL and k.value("time", (unsigned long)0)+QP::getInt("longEwmaPeriods")*6e+4>FN::T())
+          if (!mgEwmaL and k.value("time", (unsigned long)0)+qp.longEwmaPeriods*6e+4>FN::T())
             mgEwmaL = k.value("ewmaLong", 0.0);
-          if (!mgEwmaM and k.value("time", (unsigned long)0)+QP::getInt("mediumEwmaPeriods")*6e+4>FN::T())
+          if (!mgEwmaM and k.value("time", (unsigned long)0)+qp.mediumEwmaPeriods*6e+4>FN::T())
             mgEwmaM = k.value("ewmaMedium", 0.0);
-          if (!mgEwmaS and k.value("time", (unsigned long)0)+QP::getInt("shortEwmaPeriods")*6e+4>FN::T())
+          if (!mgEwmaS and k.value("time", (unsigned long)0)+qp.shortEwmaPeriods*6e+4>FN::T())
             mgEwmaS = k.value("ewmaShort", 0.0);
         }
         FN::log(argEwmaLong ? "ARG" : "DB", string("loaded EWMA Long = ") + to_string(mgEwmaL));
@@ -131,9 +140,10 @@ namespace K {
       };
       static void stdevPUp() {
         if (empty()) return;
-        double topBid = mgLevelsFilter.bids.begin()->price;
-        double topAsk = mgLevelsFilter.bids.begin()->price;
+        double topBid = mgBook.top(mSide::Bid).price;
+        double topAsk = mgBook.top(mSide::Ask).price;
         if (!topBid or !topAsk) return;
+        cleanStdev();
         mgStatFV.push_back(mgFairValue);
         mgStatBid.push_back(topBid);
         mgStatAsk.push_back(topAsk);
@@ -145,7 +155,7 @@ namespace K {
           {"bid", topBid},
           {"ask", topAsk},
           {"time", FN::T()},
-        }, false, "NULL", FN::T() - 1e+3 * QP::getInt("quotingStdevProtectionPeriods"));
+        }, false, "NULL", FN::T() - 1e+3 * QP::get().quotingStdevProtectionPeriods);
       };
       static void tradeUp(mTrade k) {
         k.exchange = gw->exchange;
@@ -156,16 +166,28 @@ namespace K {
         UI::uiSend(uiTXT::MarketTrade, k);
       };
       static void levelUp(mLevels k) {
-        filter(k);
-        UI::uiSend(uiTXT::MarketData, k, true);
+        mtTick = FN::Tns();
+        mgBook.update(k);
+        filter();
+        UI::uiLevels();
+      };
+      static void levelUp(mSide s, mLevel k, unsigned long seq) {
+        mtTick = FN::Tns();
+        if (!mgBook.update(s, k, seq)) {
+          FN::logWar("MG", string("Market levels out of sequence at ") + to_string(seq) + ", waiting for a new snapshot");
+          mgBook.update(mLevels());
+        }
+        filter();
+        UI::uiLevels();
       };
       static void ewmaUp() {
-        calcEwma(&mgEwmaL, QP::getInt("longEwmaPeriods"));
-        calcEwma(&mgEwmaM, QP::getInt("mediumEwmaPeriods"));
-        calcEwma(&mgEwmaS, QP::getInt("shortEwmaPeriods"));
+        const mQuotingParams &qp = QP::get();
+        calcEwma(&mgEwmaL, qp.longEwmaPeriods);
+        calcEwma(&mgEwmaM, qp.mediumEwmaPeriods);
+        calcEwma(&mgEwmaS, qp.shortEwmaPeriods);
         calcTargetPos();
         ev_mgTargetPosition();
-        UI::uiSend(uiTXT::EWMAChart, {
+        UI::uiSend(uiTXT::EWMAChart, []() -> json { return {
           {"stdevWidth", {
             {"fv", mgStdevFV},
             {"fvMean", mgStdevFVMean},
@@ -181,7 +203,7 @@ namespace K {
           {"ewmaMedium", mgEwmaM},
           {"ewmaLong", mgEwmaL},
           {"fairValue", mgFairValue}
-        }, true);
+        }; }, true);
         DB::insert(uiTXT::EWMAChart, {
           {"ewmaLong", mgEwmaL},
           {"ewmaMedium", mgEwmaM},
@@ -190,58 +212,37 @@ namespace K {
         });
       };
       static void ewmaPUp() {
-        calcEwma(&mgEwmaP, QP::getInt("quotingEwmaProtectionPeriods"));
+        calcEwma(&mgEwmaP, QP::get().quotingEwmaProtectionPeriods);
         ev_mgEwmaQuoteProtection();
       };
-      static void filter(mLevels k) {
-        mgLevelsFilter = k;
-        if (empty()) return;
-        ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it)
-          filter(mSide::Bid == it->second.side ? &mgLevelsFilter.bids : &mgLevelsFilter.asks, it->second);
-        ogMutex.unlock();
+      static void filter() {
         if (!empty()) {
+          MT::record(mLatency::Filter, mtTick);
+          unsigned long T = FN::Tns();
           calcFairValue();
+          MT::record(mLatency::FairValue, T);
           ev_mgLevels();
         }
       };
-      static void filter(vector<mLevel>* k, mOrder o) {
-        for (vector<mLevel>::iterator it = k->begin(); it != k->end();)
-          if (abs(it->price - o.price) < gw->minTick) {
-            it->size = it->size - o.quantity;
-            if (it->size < gw->minTick) k->erase(it);
-            break;
-          } else ++it;
-      };
       static void cleanStdev() {
-        size_t periods = (size_t)QP::getInt("quotingStdevProtectionPeriods");
-        if (mgStatFV.size()>periods) mgStatFV.erase(mgStatFV.begin(), mgStatFV.end()-periods);
-        if (mgStatBid.size()>periods) mgStatBid.erase(mgStatBid.begin(), mgStatBid.end()-periods);
-        if (mgStatAsk.size()>periods) mgStatAsk.erase(mgStatAsk.begin(), mgStatAsk.end()-periods);
-        if (mgStatTop.size()>periods*2) mgStatTop.erase(mgStatTop.begin(), mgStatTop.end()-(periods*2));
+        size_t periods = QP::get().quotingStdevProtectionPeriods;
+        mgStatFV.resize(periods);
+        mgStatBid.resize(periods);
+        mgStatAsk.resize(periods);
+        mgStatTop.resize(periods*2);
       };
       static void calcStdev() {
-        cleanStdev();
         if (mgStatFV.size() < 2 or mgStatBid.size() < 2 or mgStatAsk.size() < 2 or mgStatTop.size() < 4) return;
-        double k = QP::getDouble("quotingStdevProtectionFactor");
+        double k = QP::get().quotingStdevProtectionFactor;
         mgStdevFV = calcStdev(mgStatFV, k, &mgStdevFVMean);
         mgStdevBid = calcStdev(mgStatBid, k, &mgStdevBidMean);
         mgStdevAsk = calcStdev(mgStatAsk, k, &mgStdevAskMean);
         mgStdevTop = calcStdev(mgStatTop, k, &mgStdevTopMean);
       };
-      static double calcStdev(vector<double> a, double f, double *mean) {
-        int n = a.size();
-        if (n == 0) return 0.0;
-        double sum = 0;
-        for (int i = 0; i < n; ++i) sum += a[i];
-        *mean = sum / n;
-        double sq_diff_sum = 0;
-        for (int i = 0; i < n; ++i) {
-          double diff = a[i] - *mean;
-          sq_diff_sum += diff * diff;
-        }
-        double variance = sq_diff_sum / n;
-        return sqrt(variance) * f;
+      static double calcStdev(const mRollingStat &a, double f, double *mean) {
+        if (!a.size()) return 0.0;
+        *mean = a.mean;
+        return a.stdev() * f;
       };
       static void calcEwma(double *k, int periods) {
         if (*k) {
@@ -250,6 +251,7 @@ namespace K {
         } else *k = mgFairValue;
       };
       static void calcTargetPos() {
+        const mQuotingParams &qp = QP::get();
         mgSMA3.push_back(mgFairValue);
         if (mgSMA3.size()>3) mgSMA3.erase(mgSMA3.begin(), mgSMA3.end()-3);
         double SMA3 = 0;
@@ -257,12 +259,12 @@ namespace K {
           SMA3 += *it;
         SMA3 /= mgSMA3.size();
         double newTargetPosition = 0;
-        if ((mAutoPositionMode)QP::getInt("autoPositionMode") == mAutoPositionMode::EWMA_LMS) {
+        if (qp.autoPositionMode == mAutoPositionMode::EWMA_LMS) {
           double newTrend = ((SMA3 * 100 / mgEwmaL) - 100);
           double newEwmacrossing = ((mgEwmaS * 100 / mgEwmaM) - 100);
-          newTargetPosition = ((newTrend + newEwmacrossing) / 2) * (1 / QP::getDouble("ewmaSensiblityPercentage"));
-        } else if ((mAutoPositionMode)QP::getInt("autoPositionMode") == mAutoPositionMode::EWMA_LS)
-          newTargetPosition = ((mgEwmaS * 100/ mgEwmaL) - 100) * (1 / QP::getDouble("ewmaSensiblityPercentage"));
+          newTargetPosition = ((newTrend + newEwmacrossing) / 2) * (1 / qp.ewmaSensiblityPercentage);
+        } else if (qp.autoPositionMode == mAutoPositionMode::EWMA_LS)
+          newTargetPosition = ((mgEwmaS * 100/ mgEwmaL) - 100) * (1 / qp.ewmaSensiblityPercentage);
         if (newTargetPosition > 1) newTargetPosition = 1;
         else if (newTargetPosition < -1) newTargetPosition = -1;
         mgTargetPos = newTargetPosition;
@@ -0,0 +1,87 @@
+#ifndef K_MT_H_
+#define K_MT_H_
+
+namespace K {
+  static const char *mtStages[] = {
+    "filter", "fairvalue", "quote", "send", "ack", "fill", "ticktotrade", "http"
+  };
+  static const unsigned int mtStagesN = sizeof(mtStages) / sizeof(mtStages[0]);
+  static atomic<unsigned long> mtTick(0),
+                               mtQuote(0);
+  static mutex mtMutex;
+  static vector<mHistogram*> mtRecorders;
+  class MT {
+    public:
+      static void record(mLatency k, unsigned long T) {
+        if (!T) return;
+        unsigned long ns = FN::Tns();
+        recorder()[(unsigned int)k].record(ns > T ? ns - T : 0);
+      };
+      static json snapshot() {
+        json k;
+        for (unsigned int i = 0; i < mtStagesN; ++i) {
+          vector<unsigned long> n = merge(i);
+          k.push_back({
+            {"stage", mtStages[i]},
+            {"count", count(n)},
+            {"p50", percentile(n, .5)},
+            {"p99", percentile(n, .99)},
+            {"p999", percentile(n, .999)},
+            {"max", percentile(n, 1)}
+          });
+        }
+        return k;
+      };
+      static string metrics() {
+        stringstream k;
+        string labels = string("exchange=\"") + argExchange + "\",pair=\"" + gw->base + "/" + gw->quote + "\",";
+        k << "# TYPE K_latency_ns summary\n";
+        for (unsigned int i = 0; i < mtStagesN; ++i) {
+          vector<unsigned long> n = merge(i);
+          const double q[] = {.5, .9, .99, .999, 1};
+          for (unsigned int j = 0; j < sizeof(q) / sizeof(q[0]); ++j)
+            k << "K_latency_ns{" << labels << "stage=\"" << mtStages[i] << "\",quantile=\"" << q[j] << "\"} " << percentile(n, q[j]) << '\n';
+          k << "K_latency_ns_count{" << labels << "stage=\"" << mtStages[i] << "\"} " << count(n) << '\n';
+        }
+        return k.str();
+      };
+    private:
+      static mHistogram *recorder() {
+        static thread_local mHistogram *k = nullptr;
+        if (!k) {
+          k = new mHistogram[mtStagesN];
+          lock_guard<mutex> lock(mtMutex);
+          mtRecorders.push_back(k);
+        }
+        return k;
+      };
+      static vector<unsigned long> merge(unsigned int stage) {
+        vector<unsigned long> k(mHistogram::size, 0);
+        lock_guard<mutex> lock(mtMutex);
+        for (vector<mHistogram*>::iterator it = mtRecorders.begin(); it != mtRecorders.end(); ++it)
+          for (unsigned int i = 0; i < mHistogram::size; ++i)
+            k[i] += (*it)[stage].n[i].load(memory_order_relaxed);
+        if (stage == (unsigned int)mLatency::Http)
+          for (unsigned int i = 0; i < mHistogram::size; ++i)
+            k[i] += wLatency.n[i].load(memory_order_relaxed);
+        return k;
+      };
+      static unsigned long count(const vector<unsigned long> &k) {
+        unsigned long n = 0;
+        for (vector<unsigned long>::const_iterator it = k.begin(); it != k.end(); ++it) n += *it;
+        return n;
+      };
+      static unsigned long percentile(const vector<unsigned long> &k, double q) {
+        unsigned long n = count(k),
+                      rank = (unsigned long)ceil(q * n),
+                      sum = 0;
+        if (!n) return 0;
+        if (!rank) rank = 1;
+        for (unsigned int i = 0; i < k.size(); ++i)
+          if ((sum += k[i]) >= rank) return mHistogram::value(i);
+        return mHistogram::value(k.size() - 1);
+      };
+  };
+}
+
+#endif
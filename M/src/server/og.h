@@ -3,16 +3,21 @@
 
 namespace K {
   vector<mTrade> tradesMemory;
-  map<string, void*> toCancel;
-  map<string, string> allOrdersIds;
+  unordered_map<string, void*> toCancel;
+  unordered_map<string, string> allOrdersIds;
+  unordered_map<string, unsigned long> ogSentT;
+  mPair ogPair;
+  multimap<long, mOrder*> ogSide[2]; // allOrders by tick, for mSide::Bid and mSide::Ask
+  unsigned int ogStatus[4] = {0, 0, 0, 0}; // allOrders by mORS
   class OG {
     public:
       static void main() {
+        ogPair = mPair(gw->base, gw->quote);
         load();
         ev_gwDataOrder = [](mOrder k) {
           if (argDebugEvents) FN::log("DEBUG", "EV OG ev_gwDataOrder");
           if (argDebugOrders) FN::log("DEBUG", string("OG reply  ") + k.orderId + "::" + k.exchangeId + " [" + to_string((int)k.orderStatus) + "]: " + to_string(k.quantity) + "/" + to_string(k.lastQuantity) + " at price " + to_string(k.price));
-          //updateOrderState(k);
+          updateOrderState(k);
         };
         UI::uiSnap(uiTXT::Trades, &onSnapTrades);
         UI::uiSnap(uiTXT::OrderStatusReports, &onSnapOrders);
@@ -23,45 +28,55 @@ namespace K {
         UI::uiHand(uiTXT::CleanAllOrders, &onHandCleanAllOrders);
         UI::uiHand(uiTXT::CleanTrade, &onHandCleanTrade);
       };
-      static void allOrdersDelete(string oI, string oE) {
+      static void allOrdersDelete(const string &oI, const string &oE) {
         ogMutex.lock();
-        map<string, mOrder>::iterator it = allOrders.find(oI);
-        if (it != allOrders.end()) allOrders.erase(it);
-        if (oE != "") {
-          map<string, string>::iterator it_ = allOrdersIds.find(oE);
-          if (it_ != allOrdersIds.end()) allOrdersIds.erase(it_);
-        } else {
-          for (map<string, string>::iterator it_ = allOrdersIds.begin(); it_ != allOrdersIds.end();)
-            if (it_->second == oI) it_ = allOrdersIds.erase(it_); else ++it_;
-        }
+        unordered_map<string, mOrder>::iterator it = allOrders.find(oI);
+        if (it != allOrders.end()) {
+          allOrdersIds.erase(oE != "" ? oE : it->second.exchangeId);
+          mgBook.own(it->second.side, it->second.price, -it->second.quantity);
+          index(&it->second, false);
+          allOrders.erase(it);
+        } else if (oE != "") allOrdersIds.erase(oE);
+        ogSentT.erase(oI);
         ogMutex.unlock();
         if (argDebugOrders) FN::log("DEBUG", string("OG remove ") + oI + "::" + oE);
       };
       static void sendOrder(mSide oS, double oP, double oQ, mOrderType oLM, mTimeInForce oTIF, bool oIP, bool oPO) {
-        mOrder o = updateOrderState(mOrder(gW->randId(), gw->exchange, mPair(gw->base, gw->quote), oS, oQ, oLM, oIP, FN::roundSide(oP, gw->minTick, oS), oTIF, mORS::New, oPO));
+        mOrder o = updateOrderState(mOrder(gW->randId(), gw->exchange, ogPair, oS, oQ, oLM, oIP, FN::roundSide(oP, gw->minTick, oS), oTIF, mORS::New, oPO));
+        ogMutex.lock();
+        ogSentT[o.orderId] = FN::Tns();
+        ogMutex.unlock();
         if (argDebugOrders) FN::log("DEBUG", string("OG  send  ") + (o.side == mSide::Bid ? "BID id " : "ASK id ") + o.orderId + ": " + to_string(o.quantity) + " " + o.pair.base + " at price " + to_string(o.price) + " " + o.pair.quote);
         gW->send(o.orderId, o.side, o.price, o.quantity, o.type, o.timeInForce, o.preferPostOnly, o.time);
       };
-      static void cancelOrder(string k) {
+      static void cancelOrder(const string &k) {
         ogMutex.lock();
-        if (allOrders.find(k) == allOrders.end()) {
+        unordered_map<string, mOrder>::iterator it = allOrders.find(k);
+        if (it == allOrders.end()) {
           // updateOrderState(mOrder(k, mORS::Cancelled));
           if (argDebugOrders) FN::log("DEBUG", string("OG cancel unknown id ") + k);
           ogMutex.unlock();
           return;
         }
-        if (!gW->cancelByLocalIds and allOrders[k].exchangeId == "") {
+        if (!gW->cancelByLocalIds and it->second.exchangeId == "") {
           toCancel[k] = nullptr;
           if (argDebugOrders) FN::log("DEBUG", string("OG cancel pending id ") + k);
           ogMutex.unlock();
           return;
         }
-        mOrder o = allOrders[k];
+        mOrder o = it->second;
         ogMutex.unlock();
         if (argDebugOrders) FN::log("DEBUG", string("OG cancel ") + (o.side == mSide::Bid ? "BID id " : "ASK id ") + o.orderId + "::" + o.exchangeId);
         gW->cancel(o.orderId, o.exchangeId, o.side, o.time);
       };
+      static const multimap<long, mOrder*> &orders(mSide side) {
+        return ogSide[side == mSide::Ask];
+      };
+      static unsigned int orders(mORS status) {
+        return ogStatus[(unsigned int)status];
+      };
     private:
+      friend class BM;
       static void load() {
         json k = DB::load(uiTXT::Trades);
         if (k.size())
@@ -96,7 +111,7 @@ namespace K {
       static json onSnapOrders() {
         json k;
         ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it) {
+        for (unordered_map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it) {
           if (mORS::Working != it->second.orderStatus) continue;
           k.push_back(it->second);
         }
@@ -136,11 +151,14 @@ namespace K {
       static mOrder updateOrderState(mOrder k) {
         mOrder o;
         ogMutex.lock();
+        unordered_map<string, mOrder>::iterator it;
+        unordered_map<string, string>::iterator it_;
         if (k.orderStatus == mORS::New) o = k;
-        else if (k.orderId != "" and allOrders.find(k.orderId) != allOrders.end())
-          o = allOrders[k.orderId];
-        else if (k.exchangeId != "" and allOrdersIds.find(k.exchangeId) != allOrdersIds.end()) {
-          o = allOrders[allOrdersIds[k.exchangeId]];
+        else if (k.orderId != "" and (it = allOrders.find(k.orderId)) != allOrders.end())
+          o = it->second;
+        else if (k.exchangeId != "" and (it_ = allOrdersIds.find(k.exchangeId)) != allOrdersIds.end()
+          and (it = allOrders.find(it_->second)) != allOrders.end()) {
+          o = it->second;
           k.orderId = o.orderId;
         } else {
           ogMutex.unlock();
@@ -164,12 +182,15 @@ namespace K {
         if (k.time) o.time = k.time;
         if (k.computationalLatency) o.computationalLatency = k.computationalLatency;
         if (!o.time) o.time = FN::T();
-        if (!o.computationalLatency and o.orderStatus == mORS::Working)
+        if (!o.computationalLatency and o.orderStatus == mORS::Working) {
           o.computationalLatency = FN::T() - o.time;
+          latency(o.orderId, mLatency::Ack);
+        }
         if (o.computationalLatency) o.time = FN::T();
+        if (k.lastQuantity > 0) latency(o.orderId, mLatency::Fill);
         toMemory(o);
         if (!gW->cancelByLocalIds and o.exchangeId != "") {
-          map<string, void*>::iterator it = toCancel.find(o.orderId);
+          unordered_map<string, void*>::iterator it = toCancel.find(o.orderId);
           if (it != toCancel.end()) {
             toCancel.erase(it);
             cancelOrder(o.orderId);
@@ -186,7 +207,7 @@ namespace K {
         if (gW->supportCancelAll) return gW->cancelAll();
         vector<string> k;
         ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it)
+        for (unordered_map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it)
           if (mORS::New == (mORS)it->second.orderStatus or mORS::Working == (mORS)it->second.orderStatus)
             k.push_back(it->first);
         ogMutex.unlock();
@@ -225,6 +246,7 @@ namespace K {
         }
       };
       static void toHistory(mOrder o) {
+        const mQuotingParams &qp = QP::get();
         double fee = 0;
         double val = abs(o.price * o.lastQuantity);
         mTrade trade(
@@ -239,35 +261,35 @@ namespace K {
         );
         FN::log(trade, argExchange);
         ev_ogTrade(trade);
-        if (QP::matchPings()) {
-          double widthPong = QP::getBool("widthPercentage")
-            ? QP::getDouble("widthPongPercentage") * trade.price / 100
-            : QP::getDouble("widthPong");
-          map<double, string> matches;
+        if (QP::matchPings(qp)) {
+          double widthPong = qp.widthPercentage
+            ? qp.widthPongPercentage * trade.price / 100
+            : qp.widthPong;
+          map<long, string> matches;
           for (vector<mTrade>::iterator it = tradesMemory.begin(); it != tradesMemory.end(); ++it)
             if (it->quantity - it->Kqty > 0
               and it->side == (trade.side == mSide::Bid ? mSide::Ask : mSide::Bid)
               and (trade.side == mSide::Bid ? (it->price > trade.price + widthPong) : (it->price < trade.price - widthPong))
-            ) matches[it->price] = it->tradeId;
-          matchPong(matches, ((mPongAt)QP::getInt("pongAt") == mPongAt::LongPingFair or (mPongAt)QP::getInt("pongAt") == mPongAt::LongPingAggressive) ? trade.side == mSide::Ask : trade.side == mSide::Bid, trade);
+            ) matches[FN::ticks(it->price, gw->minTick)] = it->tradeId;
+          matchPong(matches, (qp.pongAt == mPongAt::LongPingFair or qp.pongAt == mPongAt::LongPingAggressive) ? trade.side == mSide::Ask : trade.side == mSide::Bid, trade);
         } else {
           UI::uiSend(uiTXT::Trades, trade);
           DB::insert(uiTXT::Trades, trade, false, trade.tradeId);
           tradesMemory.push_back(trade);
         }
-        UI::uiSend(uiTXT::TradesChart, {
+        UI::uiSend(uiTXT::TradesChart, [&]() -> json { return {
           {"price", trade.price},
           {"side", (int)trade.side},
           {"quantity", trade.quantity},
           {"value", trade.value},
           {"pong", o.isPong}
-        });
-        cleanAuto(trade.time, QP::getDouble("cleanPongsAuto"));
+        }; });
+        cleanAuto(trade.time, qp.cleanPongsAuto);
       };
-      static void matchPong(map<double, string> matches, bool reverse, mTrade pong) {
-        if (reverse) for (map<double, string>::reverse_iterator it = matches.rbegin(); it != matches.rend(); ++it) {
+      static void matchPong(map<long, string> matches, bool reverse, mTrade pong) {
+        if (reverse) for (map<long, string>::reverse_iterator it = matches.rbegin(); it != matches.rend(); ++it) {
           if (!matchPong(it->second, &pong)) break;
-        } else for (map<double, string>::iterator it = matches.begin(); it != matches.end(); ++it)
+        } else for (map<long, string>::iterator it = matches.begin(); it != matches.end(); ++it)
           if (!matchPong(it->second, &pong)) break;
         if (pong.quantity > 0) {
           bool eq = false;
@@ -308,6 +330,13 @@ namespace K {
         }
         return pong->quantity > 0;
       };
+      static void latency(const string &k, mLatency stage) {
+        ogMutex.lock();
+        unordered_map<string, unsigned long>::iterator it = ogSentT.find(k);
+        unsigned long T = it == ogSentT.end() ? 0 : it->second;
+        ogMutex.unlock();
+        MT::record(stage, T);
+      };
       static void cleanAuto(unsigned long k, double pT) {
         if (pT == 0) return;
         unsigned long pT_ = k - (abs(pT) * 864e5);
@@ -320,12 +349,31 @@ namespace K {
           } else ++it;
         }
       };
+      static void index(mOrder *k, bool add) {
+        multimap<long, mOrder*> &side = ogSide[k->side == mSide::Ask];
+        if (add) {
+          side.insert(pair<long, mOrder*>(FN::ticks(k->price, gw->minTick), k));
+          ++ogStatus[(unsigned int)k->orderStatus];
+          return;
+        }
+        pair<multimap<long, mOrder*>::iterator, multimap<long, mOrder*>::iterator> range = side.equal_range(FN::ticks(k->price, gw->minTick));
+        for (multimap<long, mOrder*>::iterator it = range.first; it != range.second; ++it)
+          if (it->second == k) { side.erase(it); break; }
+        --ogStatus[(unsigned int)k->orderStatus];
+      };
       static void toMemory(mOrder k) {
         if (k.orderStatus != mORS::Cancelled and k.orderStatus != mORS::Complete) {
           ogMutex.lock();
           if (k.exchangeId != "")
             allOrdersIds[k.exchangeId] = k.orderId;
-          allOrders[k.orderId] = k;
+          unordered_map<string, mOrder>::iterator it = allOrders.find(k.orderId);
+          if (it != allOrders.end()) {
+            mgBook.own(it->second.side, it->second.price, -it->second.quantity);
+            index(&it->second, false);
+            it->second = k;
+          } else it = allOrders.insert(pair<string, mOrder>(k.orderId, k)).first;
+          mgBook.own(k.side, k.price, k.quantity);
+          index(&it->second, true);
           ogMutex.unlock();
           if (argDebugOrders) FN::log("DEBUG", string("OG  save  ") + (k.side == mSide::Bid ? "BID id " : "ASK id ") + k.orderId + "::" + k.exchangeId + " [" + to_string((int)k.orderStatus) + "]: " + to_string(k.quantity) + " " + k.pair.base + " at price " + to_string(k.price) + " " + k.pair.quote);
         } else allOrdersDelete(k.orderId, k.exchangeId);
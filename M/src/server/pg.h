@@ -4,10 +4,11 @@
 namespace K {
   mPosition pgPos;
   mSafety pgSafety;
-  map<double, mTrade> pgBuys;
-  map<double, mTrade> pgSells;
+  map<long, mTrade> pgBuys;
+  map<long, mTrade> pgSells;
   double pgTargetBasePos = 0;
   string pgSideAPR = "";
+  bool pgScreen = false;
   class PG {
     public:
       static void main() {
@@ -19,7 +20,7 @@ namespace K {
         ev_ogOrder = [](mOrder k) {
           if (argDebugEvents) FN::log("DEBUG", string("EV PG ev_ogOrder mOrder ") + ((json)k).dump());
           calcWalletAfterOrder(k);
-          FN::screen_refresh();
+          pgScreen = true;
         };
         ev_mgTargetPosition = []() {
           if (argDebugEvents) FN::log("DEBUG", "EV PG ev_mgTargetPosition");
@@ -28,6 +29,7 @@ namespace K {
         UI::uiSnap(uiTXT::Position, &onSnapPos);
         UI::uiSnap(uiTXT::TradeSafetyValue, &onSnapSafety);
         UI::uiSnap(uiTXT::TargetBasePosition, &onSnapTargetBasePos);
+        if (!argNaked) TM::every(1e+5, &screen);
       };
       static void calcSafety() {
         if (empty() or !mgFairValue) return;
@@ -44,15 +46,16 @@ namespace K {
         } else pgMutex.unlock();
       };
       static void calcTargetBasePos() {
+        const mQuotingParams &qp = QP::get();
         static string pgSideAPR_ = "!=";
         if (empty()) { FN::logWar("QE", "Unable to calculate TBP, missing market data."); return; }
         pgMutex.lock();
         double value = pgPos.value;
         pgMutex.unlock();
-        double targetBasePosition = ((mAutoPositionMode)QP::getInt("autoPositionMode") == mAutoPositionMode::Manual)
-          ? (QP::getBool("percentageValues")
-            ? QP::getDouble("targetBasePositionPercentage") * value / 1e+2
-            : QP::getDouble("targetBasePosition"))
+        double targetBasePosition = (qp.autoPositionMode == mAutoPositionMode::Manual)
+          ? (qp.percentageValues
+            ? qp.targetBasePositionPercentage * value / 1e+2
+            : qp.targetBasePosition)
           : ((1 + mgTargetPos) / 2) * value;
         if (pgTargetBasePos and abs(pgTargetBasePos - targetBasePosition) < 1e-4 and pgSideAPR_ == pgSideAPR) return;
         pgTargetBasePos = targetBasePosition;
@@ -67,14 +70,26 @@ namespace K {
       };
       static void addTrade(mTrade k) {
         mTrade k_(k.price, k.quantity, k.time);
-        if (k.side == mSide::Bid) pgBuys[k.price] = k_;
-        else pgSells[k.price] = k_;
+        if (k.side == mSide::Bid) pgBuys[FN::ticks(k.price, gw->minTick)] = k_;
+        else pgSells[FN::ticks(k.price, gw->minTick)] = k_;
       };
       static bool empty() {
         lock_guard<mutex> lock(pgMutex);
         return !pgPos.value;
       };
     private:
+      friend class BM;
+      static void screen() {
+        if (!pgScreen) return;
+        pgScreen = false;
+        vector<mOrder> k;
+        ogMutex.lock();
+        for (unordered_map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it)
+          if (mORS::Working == it->second.orderStatus) k.push_back(it->second);
+        ogMutex.unlock();
+        sort(k.begin(), k.end(), [](const mOrder &a, const mOrder &b) { return a.price > b.price; });
+        FN::screen_orders(move(k));
+      };
       static void load() {
         json k = DB::load(uiTXT::TargetBasePosition);
         if (k.size()) {
@@ -98,44 +113,45 @@ namespace K {
         return {{{"tbp", pgTargetBasePos}, {"sideAPR", pgSideAPR}}};
       };
       static mSafety nextSafety() {
+        const mQuotingParams &qp = QP::get();
         pgMutex.lock();
         double value          = pgPos.value,
                baseAmount     = pgPos.baseAmount,
                baseHeldAmount = pgPos.baseHeldAmount;
         pgMutex.unlock();
-        double buySize = QP::getBool("percentageValues")
-          ? QP::getDouble("buySizePercentage") * value / 100
-          : QP::getDouble("buySize");
-        double sellSize = QP::getBool("percentageValues")
-          ? QP::getDouble("sellSizePercentage") * value / 100
-          : QP::getDouble("sellSize");
+        double buySize = qp.percentageValues
+          ? qp.buySizePercentage * value / 100
+          : qp.buySize;
+        double sellSize = qp.percentageValues
+          ? qp.sellSizePercentage * value / 100
+          : qp.sellSize;
         double totalBasePosition = baseAmount + baseHeldAmount;
-        if (QP::getBool("buySizeMax") and (mAPR)QP::getInt("aggressivePositionRebalancing") != mAPR::Off)
+        if (qp.buySizeMax and qp.aggressivePositionRebalancing != mAPR::Off)
           buySize = fmax(buySize, pgTargetBasePos - totalBasePosition);
-        if (QP::getBool("sellSizeMax") and (mAPR)QP::getInt("aggressivePositionRebalancing") != mAPR::Off)
+        if (qp.sellSizeMax and qp.aggressivePositionRebalancing != mAPR::Off)
           sellSize = fmax(sellSize, totalBasePosition - pgTargetBasePos);
-        double widthPong = QP::getBool("widthPercentage")
-          ? QP::getDouble("widthPongPercentage") * mgFairValue / 100
-          : QP::getDouble("widthPong");
-        map<double, mTrade> tradesBuy;
-        map<double, mTrade> tradesSell;
+        double widthPong = qp.widthPercentage
+          ? qp.widthPongPercentage * mgFairValue / 100
+          : qp.widthPong;
+        map<long, mTrade> tradesBuy;
+        map<long, mTrade> tradesSell;
         for (vector<mTrade>::iterator it = tradesMemory.begin(); it != tradesMemory.end(); ++it)
           if (it->side == mSide::Bid)
-            tradesBuy[it->price] = *it;
-          else tradesSell[it->price] = *it;
+            tradesBuy[FN::ticks(it->price, gw->minTick)] = *it;
+          else tradesSell[FN::ticks(it->price, gw->minTick)] = *it;
         double buyPing = 0;
         double sellPong = 0;
         double buyQty = 0;
         double sellQty = 0;
-        if ((mPongAt)QP::getInt("pongAt") == mPongAt::ShortPingFair
-          or (mPongAt)QP::getInt("pongAt") == mPongAt::ShortPingAggressive
+        if (qp.pongAt == mPongAt::ShortPingFair
+          or qp.pongAt == mPongAt::ShortPingAggressive
         ) {
           matchBestPing(&tradesBuy, &buyPing, &buyQty, sellSize, widthPong, true);
           matchBestPing(&tradesSell, &sellPong, &sellQty, buySize, widthPong);
           if (!buyQty) matchFirstPing(&tradesBuy, &buyPing, &buyQty, sellSize, widthPong*-1, true);
           if (!sellQty) matchFirstPing(&tradesSell, &sellPong, &sellQty, buySize, widthPong*-1);
-        } else if ((mPongAt)QP::getInt("pongAt") == mPongAt::LongPingFair
-          or (mPongAt)QP::getInt("pongAt") == mPongAt::LongPingAggressive
+        } else if (qp.pongAt == mPongAt::LongPingFair
+          or qp.pongAt == mPongAt::LongPingAggressive
         ) {
           matchLastPing(&tradesBuy, &buyPing, &buyQty, sellSize, widthPong);
           matchLastPing(&tradesSell, &sellPong, &sellQty, buySize, widthPong, true);
@@ -153,21 +169,21 @@ namespace K {
           sellPong
         );
       };
-      static void matchFirstPing(map<double, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
+      static void matchFirstPing(map<long, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
         matchPing(QP::matchPings(), true, true, trades, ping, qty, qtyMax, width, reverse);
       };
-      static void matchBestPing(map<double, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
+      static void matchBestPing(map<long, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
         matchPing(QP::matchPings(), true, false, trades, ping, qty, qtyMax, width, reverse);
       };
-      static void matchLastPing(map<double, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
+      static void matchLastPing(map<long, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
         matchPing(QP::matchPings(), false, true, trades, ping, qty, qtyMax, width, reverse);
       };
-      static void matchPing(bool matchPings, bool near, bool far, map<double, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
+      static void matchPing(bool matchPings, bool near, bool far, map<long, mTrade>* trades, double* ping, double* qty, double qtyMax, double width, bool reverse = false) {
         int dir = width > 0 ? 1 : -1;
-        if (reverse) for (map<double, mTrade>::reverse_iterator it = trades->rbegin(); it != trades->rend(); ++it) {
+        if (reverse) for (map<long, mTrade>::reverse_iterator it = trades->rbegin(); it != trades->rend(); ++it) {
           if (matchPing(matchPings, near, far, ping, width, qty, qtyMax, dir * mgFairValue, dir * it->second.price, it->second.quantity, it->second.price, it->second.Kqty, reverse))
             break;
-        } else for (map<double, mTrade>::iterator it = trades->begin(); it != trades->end(); ++it)
+        } else for (map<long, mTrade>::iterator it = trades->begin(); it != trades->end(); ++it)
           if (matchPing(matchPings, near, far, ping, width, qty, qtyMax, dir * mgFairValue, dir * it->second.price, it->second.quantity, it->second.price, it->second.Kqty, reverse))
             break;
       };
@@ -190,10 +206,10 @@ namespace K {
         if (pgSells.size()) expire(&pgSells);
         skip();
       };
-      static void expire(map<double, mTrade>* k) {
+      static void expire(map<long, mTrade>* k) {
         unsigned long now = FN::T();
-        for (map<double, mTrade>::iterator it = k->begin(); it != k->end();)
-          if (it->second.time + QP::getDouble("tradeRateSeconds") * 1e+3 > now) ++it;
+        for (map<long, mTrade>::iterator it = k->begin(); it != k->end();)
+          if (it->second.time + QP::get().tradeRateSeconds * 1e+3 > now) ++it;
           else it = k->erase(it);
       };
       static void skip() {
@@ -210,9 +226,9 @@ namespace K {
             pgSells.erase(pgSells.begin());
         }
       };
-      static double sum(map<double, mTrade>* k) {
+      static double sum(map<long, mTrade>* k) {
         double sum = 0;
-        for (map<double, mTrade>::iterator it = k->begin(); it != k->end(); ++it)
+        for (map<long, mTrade>::iterator it = k->begin(); it != k->end(); ++it)
           sum += it->second.quantity;
         return sum;
       };
@@ -239,7 +255,7 @@ namespace K {
         profitMutex.lock();
         pgProfit.push_back(mProfit(baseValue, quoteValue, now));
         for (vector<mProfit>::iterator it = pgProfit.begin(); it != pgProfit.end();)
-          if (it->time + (QP::getDouble("profitHourInterval") * 36e+5) > now) ++it;
+          if (it->time + (QP::get().profitHourInterval * 36e+5) > now) ++it;
           else it = pgProfit.erase(it);
         mPosition pos(
           baseWallet.amount,
@@ -271,6 +287,7 @@ namespace K {
         pgPos = pos;
         pgMutex.unlock();
         if (!eq) calcTargetBasePos();
+        ev_pgPosition();
         UI::uiSend(uiTXT::Position, pos, true);
       };
       static void calcWalletAfterOrder(mOrder k) {
@@ -282,7 +299,7 @@ namespace K {
           : pgPos.quoteAmount + pgPos.quoteHeldAmount;
         pgMutex.unlock();
         ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it) {
+        for (unordered_map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it) {
           if (it->second.side != k.side) continue;
           double held = it->second.quantity * (it->second.side == mSide::Bid ? it->second.price : 1);
           if (amount >= held) {
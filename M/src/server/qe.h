@@ -4,7 +4,7 @@
 namespace K {
   unsigned int qeT = 0;
   unsigned long qeNextT = 0,
-                qeThread = 0;
+                qeTimer = 0;
   mQuote qeQuote;
   mQuoteStatus qeStatus;
   mQuoteState qeBidStatus = mQuoteState::MissingData,
@@ -14,21 +14,14 @@ namespace K {
   map<mSide, mLevel> qeNextQuote;
   mConnectivity gwQuotingState_ = mConnectivity::Disconnected,
                 gwConnectExchange_ = mConnectivity::Disconnected;
+  unsigned long qeCalcT = 0,
+                qeLatency = 0;
+  unsigned int qeCalcN = 0;
   class QE {
     public:
       static void main() {
         load();
-        thread([&]() {
-          while (true) {
-            this_thread::sleep_for(chrono::seconds(1));
-            if (argDebugEvents) FN::log("DEBUG", "EV QE calc thread");
-            if (mgFairValue) {
-              MG::calcStats();
-              PG::calcSafety();
-              calcQuote();
-            } else FN::logWar("QE", "Unable to calculate quote, missing fair value");
-          }
-        }).detach();
+        if (argReplay == "") TM::every(1e+6, &stats);
         ev_gwConnectButton = [](mConnectivity k) {
           if (argDebugEvents) FN::log("DEBUG", "EV QE v_gwConnectButton");
           gwQuotingState_ = k;
@@ -43,29 +36,66 @@ namespace K {
           MG::calcFairValue();
           PG::calcTargetBasePos();
           PG::calcSafety();
-          calcQuote();
+          calc();
         };
         ev_ogTrade = [](mTrade k) {
           if (argDebugEvents) FN::log("DEBUG", "EV QE ev_ogTrade");
           PG::addTrade(k);
           PG::calcSafety();
-          calcQuote();
+          calc();
         };
         ev_mgEwmaQuoteProtection = []() {
           if (argDebugEvents) FN::log("DEBUG", "EV QE ev_mgEwmaQuoteProtection");
-          calcQuote();
+          calc();
         };
         ev_mgLevels = []() {
           if (argDebugEvents) FN::log("DEBUG", "EV QE ev_mgLevels");
-          calcQuote();
+          calc();
         };
         ev_pgTargetBasePosition = []() {
           if (argDebugEvents) FN::log("DEBUG", "EV QE ev_pgTargetBasePosition");
-          calcQuote();
+          calc();
+        };
+        ev_pgPosition = []() {
+          if (argDebugEvents) FN::log("DEBUG", "EV QE ev_pgPosition");
+          calc();
         };
         UI::uiSnap(uiTXT::QuoteStatus, &onSnap);
       }
+      static void stats() {
+        if (mgFairValue) {
+          MG::calcStats();
+          PG::calcSafety();
+          calc();
+        } else FN::logWar("QE", "Unable to calculate quote, missing fair value");
+      };
+      static void calc() {
+        if (argReplay != "") return calcSync();
+        if (!qeCalcT) qeCalcT = FN::Tns();
+        ++qeCalcN;
+      };
+      static void calcPending() {
+        if (!qeCalcT) return;
+        unsigned long T = qeCalcT;
+        unsigned int n = qeCalcN;
+        qeCalcT = 0;
+        qeCalcN = 0;
+        calcQuote();
+        qeLatency = FN::Tns() - T;
+        MT::record(mLatency::Quote, T);
+        if (argDebugQuotes) FN::log("DEBUG", string("QE tick-to-quote ") + to_string(qeLatency / 1e+3) + "us after " + to_string(n) + " events");
+      };
     private:
+      friend class BM;
+      static void calcSync() {
+        if (qeCalcN++) return;
+        while (true) {
+          calcQuote();
+          if (qeCalcN == 1) break;
+          qeCalcN = 1;
+        }
+        qeCalcN = 0;
+      };
       static void load() {
         qeQuotingMode[mQuotingMode::Top] = &calcTopOfMarket;
         qeQuotingMode[mQuotingMode::Mid] = &calcMidOfMarket;
@@ -97,12 +127,13 @@ namespace K {
         quote.ask = quotesAreSame(quote.ask.price, quote.ask.size, mSide::Ask);
         if ((!qeQuote.bid.price and !qeQuote.ask.price and !quote.bid.price and !quote.ask.price) or (
           qeQuote.bid.price and qeQuote.ask.price and quote.bid.price and quote.ask.price
-          and abs(qeQuote.bid.price - quote.bid.price) < gw->minTick
-          and abs(qeQuote.ask.price - quote.ask.price) < gw->minTick
+          and FN::ticks(qeQuote.bid.price, gw->minTick) == FN::ticks(quote.bid.price, gw->minTick)
+          and FN::ticks(qeQuote.ask.price, gw->minTick) == FN::ticks(quote.ask.price, gw->minTick)
           and abs(qeQuote.bid.size - quote.bid.size) < gw->minSize
           and abs(qeQuote.ask.size - quote.ask.size) < gw->minSize
         )) return;
         qeQuote = quote;
+        mtQuote = FN::Tns();
 
         if (argDebugQuotes) {
         	FN::log("DEBUG", string("QE quote! ") + ((json)qeQuote).dump());
@@ -110,54 +141,9 @@ namespace K {
         send();
       };
       static void send() {
-        //sendQuoteToAPI();
-    	sendQuoteToRuby();
+        sendQuoteToAPI();
         sendQuoteToUI();
       };
-
-      static void sendQuoteToRuby(){
-
-        string BasePair = K::argCurrency;
-        string qeQuoteAskPrice;
-        string qeQuoteAskSize;
-        string qeQuoteBidPrice;
-        string qeQuoteBidSize;
-
-        qeQuoteAskPrice = std::to_string(qeQuote.ask.price);
-        qeQuoteAskSize = std::to_string(qeQuote.ask.size);
-        qeQuoteBidPrice = std::to_string(qeQuote.bid.price);
-        qeQuoteBidSize = std::to_string(qeQuote.bid.size);
-
-
-        cout << "BasePair: " << BasePair << endl;
-        cout << "qeQuoteAskPrice: " << qeQuoteAskPrice << " qeQuoteAskSize: " << qeQuoteAskSize<< endl;
-        cout << "qeQuoteBidPrice: " << qeQuoteBidPrice << " qeQuoteBidSize: " << qeQuoteBidSize<< endl;
-        string FirstThree = BasePair.substr(0,3);
-        string LastThree = BasePair.substr(4,7);
-        cout << "FirstThree: " << FirstThree << " LastThree:" << LastThree << endl;
-
-        if (qeQuote.ask.price > 0) {
-
-          cout << "sending short quote to Peatio" << endl;
-          std::stringstream Quote;
-          Quote <<"/home/deploy/.rbenv/versions/2.2.1/bin/ruby -s home/peatio/current/pc/api.rb" << " " << FirstThree << LastThree << " " << qeQuoteAskSize << " " << "sell" << " " << qeQuoteAskPrice;
-          const string quote = Quote.str().c_str();
-          cout << "Quote parameters: " << quote << endl;
-          system(quote.c_str());
-         // printf(quote.c_str());
-        }
-        else if (qeQuote.bid.price > 0){
-            cout << "sending buy quote to Peatio" << endl;
-              std::stringstream Quote;
-            Quote <<"/home/deploy/.rbenv/versions/2.2.1/bin/ruby -s home/peatio/current/pc/api.rb" << " " << FirstThree << LastThree << " " << qeQuoteBidSize << " " << "buy" << " " << qeQuoteBidPrice;
-            const string quote = Quote.str().c_str();
-            cout << "Quote parameters: " << quote << endl;
-           // printf(quote.c_str());
-            system(quote.c_str());
-        }
-
-        //system("/home/deploy/.rbenv/versions/2.2.1/bin/ruby -s ~/peatio/pc/api.rb btceur 1 buy 2017.0");
-      }
       static void sendQuoteToAPI() {
         if (gwConnectExchange_ == mConnectivity::Disconnected or (!qeQuote.bid.price and !qeQuote.ask.price)) {
           qeAskStatus = mQuoteState::Disconnected;
@@ -188,21 +174,21 @@ namespace K {
         UI::uiSend(uiTXT::QuoteStatus, qeStatus, true);
       };
       static bool diffCounts(unsigned int *qNew, unsigned int *qWorking, unsigned int *qDone) {
-        vector<string> toDelete;
-        unsigned long T = FN::T();
-        ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it) {
-          mORS k = (mORS)it->second.orderStatus;
-          if (k == mORS::New) {
-            if (it->second.exchangeId == "" and T-1e+4>it->second.time)
-              toDelete.push_back(it->first);
-            ++(*qNew);
-          } else if (k == mORS::Working) ++(*qWorking);
-          else ++(*qDone);
-        }
-        ogMutex.unlock();
-        for (vector<string>::iterator it = toDelete.begin(); it != toDelete.end(); ++it)
-          OG::allOrdersDelete(*it, "");
+        if (OG::orders(mORS::New)) {
+          vector<string> toDelete;
+          unsigned long T = FN::T();
+          for (unsigned int i = 0; i < 2; ++i) {
+            const multimap<long, mOrder*> &orderSide = OG::orders(i ? mSide::Ask : mSide::Bid);
+            for (multimap<long, mOrder*>::const_iterator it = orderSide.begin(); it != orderSide.end(); ++it)
+              if (it->second->orderStatus == mORS::New and it->second->exchangeId == "" and T-1e+4>it->second->time)
+                toDelete.push_back(it->second->orderId);
+          }
+          for (vector<string>::iterator it = toDelete.begin(); it != toDelete.end(); ++it)
+            OG::allOrdersDelete(*it, "");
+        }
+        *qNew = OG::orders(mORS::New);
+        *qWorking = OG::orders(mORS::Working);
+        *qDone = OG::orders(mORS::Complete) + OG::orders(mORS::Cancelled);
         return diffCounts(*qNew, *qWorking, *qDone);
       };
       static bool diffCounts(unsigned int qNew, unsigned int qWorking, unsigned int qDone) {
@@ -222,7 +208,7 @@ namespace K {
         mLevel prevQuote = mSide::Bid == side ? qeQuote.bid : qeQuote.ask;
         if (!prevQuote.price) return newQuote;
         if (abs(size - prevQuote.size) > 5e-3) return newQuote;
-        if (abs(price - prevQuote.price) < gw->minTick) return prevQuote;
+        if (FN::ticks(price, gw->minTick) == FN::ticks(prevQuote.price, gw->minTick)) return prevQuote;
         bool quoteWasWidened = true;
         if ((mSide::Bid == side and prevQuote.price < price)
           or (mSide::Ask == side and prevQuote.price > price)
@@ -233,6 +219,7 @@ namespace K {
         return newQuote;
       };
       static mQuote nextQuote() {
+        const mQuotingParams &qp = QP::get();
         if (MG::empty() or PG::empty()) return mQuote();
         pgMutex.lock();
         double value           = pgPos.value,
@@ -245,23 +232,23 @@ namespace K {
                safetyBuy       = pgSafety.buy,
                safetySell      = pgSafety.sell;
         pgMutex.unlock();
-        double widthPing = QP::getBool("widthPercentage")
-          ? QP::getDouble("widthPingPercentage") * mgFairValue / 100
-          : QP::getDouble("widthPing");
-        double widthPong = QP::getBool("widthPercentage")
-          ? QP::getDouble("widthPongPercentage") * mgFairValue / 100
-          : QP::getDouble("widthPong");
+        double widthPing = qp.widthPercentage
+          ? qp.widthPingPercentage * mgFairValue / 100
+          : qp.widthPing;
+        double widthPong = qp.widthPercentage
+          ? qp.widthPongPercentage * mgFairValue / 100
+          : qp.widthPong;
         double totalBasePosition = baseAmount + baseHeldAmount;
         double totalQuotePosition = (quoteAmount + quoteHeldAmount) / mgFairValue;
-        double buySize = QP::getBool("percentageValues")
-          ? QP::getDouble("buySizePercentage") * value / 100
-          : QP::getDouble("buySize");
-        double sellSize = QP::getBool("percentageValues")
-          ? QP::getDouble("sellSizePercentage") * value / 100
-          : QP::getDouble("sellSize");
-        if (buySize and (mAPR)QP::getInt("aggressivePositionRebalancing") != mAPR::Off and QP::getBool("buySizeMax"))
+        double buySize = qp.percentageValues
+          ? qp.buySizePercentage * value / 100
+          : qp.buySize;
+        double sellSize = qp.percentageValues
+          ? qp.sellSizePercentage * value / 100
+          : qp.sellSize;
+        if (buySize and qp.aggressivePositionRebalancing != mAPR::Off and qp.buySizeMax)
           buySize = fmax(buySize, pgTargetBasePos - totalBasePosition);
-        if (sellSize and (mAPR)QP::getInt("aggressivePositionRebalancing") != mAPR::Off and QP::getBool("sellSizeMax"))
+        if (sellSize and qp.aggressivePositionRebalancing != mAPR::Off and qp.sellSizeMax)
           sellSize = fmax(sellSize, totalBasePosition - pgTargetBasePos);
         mQuote rawQuote = quote(widthPing, buySize, sellSize);
         if (argDebugQuotes) FN::log("DEBUG", string("QE quote? ") +((json)rawQuote).dump());
@@ -276,24 +263,24 @@ namespace K {
         qeBidStatus = mQuoteState::UnknownHeld;
         qeAskStatus = mQuoteState::UnknownHeld;
         vector<int> superTradesMultipliers = {1, 1};
-        if ((mSOP)QP::getInt("superTrades") != mSOP::Off
-          and widthPing * QP::getInt("sopWidthMultiplier") < mgLevelsFilter.asks.begin()->price - mgLevelsFilter.bids.begin()->price
+        if (qp.superTrades != mSOP::Off
+          and widthPing * qp.sopWidthMultiplier < mgBook.top(mSide::Ask).price - mgBook.top(mSide::Bid).price
         ) {
-          superTradesMultipliers[0] = (mSOP)QP::getInt("superTrades") == mSOP::x2trades or (mSOP)QP::getInt("superTrades") == mSOP::x2tradesSize
-            ? 2 : ((mSOP)QP::getInt("superTrades") == mSOP::x3trades or (mSOP)QP::getInt("superTrades") == mSOP::x3tradesSize
+          superTradesMultipliers[0] = qp.superTrades == mSOP::x2trades or qp.superTrades == mSOP::x2tradesSize
+            ? 2 : (qp.superTrades == mSOP::x3trades or qp.superTrades == mSOP::x3tradesSize
               ? 3 : 1);
-          superTradesMultipliers[1] = (mSOP)QP::getInt("superTrades") == mSOP::x2Size or (mSOP)QP::getInt("superTrades") == mSOP::x2tradesSize
-            ? 2 : ((mSOP)QP::getInt("superTrades") == mSOP::x3Size or (mSOP)QP::getInt("superTrades") == mSOP::x3tradesSize
+          superTradesMultipliers[1] = qp.superTrades == mSOP::x2Size or qp.superTrades == mSOP::x2tradesSize
+            ? 2 : (qp.superTrades == mSOP::x3Size or qp.superTrades == mSOP::x3tradesSize
               ? 3 : 1);
         }
-        double pDiv = QP::getBool("percentageValues")
-          ? QP::getDouble("positionDivergencePercentage") * value / 100
-          : QP::getDouble("positionDivergence");
+        double pDiv = qp.percentageValues
+          ? qp.positionDivergencePercentage * value / 100
+          : qp.positionDivergence;
         if (superTradesMultipliers[1] > 1) {
-          if (!QP::getBool("buySizeMax")) rawQuote.bid.size = fmin(superTradesMultipliers[1]*buySize, (quoteAmount / mgFairValue) / 2);
-          if (!QP::getBool("sellSizeMax")) rawQuote.ask.size = fmin(superTradesMultipliers[1]*sellSize, baseAmount / 2);
+          if (!qp.buySizeMax) rawQuote.bid.size = fmin(superTradesMultipliers[1]*buySize, (quoteAmount / mgFairValue) / 2);
+          if (!qp.sellSizeMax) rawQuote.ask.size = fmin(superTradesMultipliers[1]*sellSize, baseAmount / 2);
         }
-        if (QP::getBool("quotingEwmaProtection") and mgEwmaP) {
+        if (qp.quotingEwmaProtection and mgEwmaP) {
           rawQuote.ask.price = fmax(mgEwmaP, rawQuote.ask.price);
           rawQuote.bid.price = fmin(mgEwmaP, rawQuote.bid.price);
         }
@@ -302,41 +289,41 @@ namespace K {
           qeAskStatus = mQuoteState::TBPHeld;
           rawQuote.ask.price = 0;
           rawQuote.ask.size = 0;
-          if ((mAPR)QP::getInt("aggressivePositionRebalancing") != mAPR::Off) {
+          if (qp.aggressivePositionRebalancing != mAPR::Off) {
             pgSideAPR = "Buy";
-            if (!QP::getBool("buySizeMax")) rawQuote.bid.size = fmin(QP::getInt("aprMultiplier")*buySize, fmin(pgTargetBasePos - totalBasePosition, (quoteAmount / mgFairValue) / 2));
+            if (!qp.buySizeMax) rawQuote.bid.size = fmin(qp.aprMultiplier*buySize, fmin(pgTargetBasePos - totalBasePosition, (quoteAmount / mgFairValue) / 2));
           }
         }
         else if (totalBasePosition >= pgTargetBasePos + pDiv) {
           qeBidStatus = mQuoteState::TBPHeld;
           rawQuote.bid.price = 0;
           rawQuote.bid.size = 0;
-          if ((mAPR)QP::getInt("aggressivePositionRebalancing") != mAPR::Off) {
+          if (qp.aggressivePositionRebalancing != mAPR::Off) {
             pgSideAPR = "Sell";
-            if (!QP::getBool("sellSizeMax")) rawQuote.ask.size = fmin(QP::getInt("aprMultiplier")*sellSize, fmin(totalBasePosition - pgTargetBasePos, baseAmount / 2));
+            if (!qp.sellSizeMax) rawQuote.ask.size = fmin(qp.aprMultiplier*sellSize, fmin(totalBasePosition - pgTargetBasePos, baseAmount / 2));
           }
         }
         if (argDebugQuotes) FN::log("DEBUG", string("QE quote¿ ") + ((json)rawQuote).dump());
-        if ((mSTDEV)QP::getInt("quotingStdevProtection") != mSTDEV::Off and mgStdevFV) {
-          if (rawQuote.ask.price and ((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFV or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTops or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTop or pgSideAPR != "Sell"))
+        if (qp.quotingStdevProtection != mSTDEV::Off and mgStdevFV) {
+          if (rawQuote.ask.price and (qp.quotingStdevProtection == mSTDEV::OnFV or qp.quotingStdevProtection == mSTDEV::OnTops or qp.quotingStdevProtection == mSTDEV::OnTop or pgSideAPR != "Sell"))
             rawQuote.ask.price = fmax(
-              (QP::getBool("quotingStdevBollingerBands")
-                ? ((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFV or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFVAPROff)
-                  ? mgStdevFVMean : (((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTops or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTopsAPROff)
+              (qp.quotingStdevBollingerBands
+                ? (qp.quotingStdevProtection == mSTDEV::OnFV or qp.quotingStdevProtection == mSTDEV::OnFVAPROff)
+                  ? mgStdevFVMean : ((qp.quotingStdevProtection == mSTDEV::OnTops or qp.quotingStdevProtection == mSTDEV::OnTopsAPROff)
                     ? mgStdevTopMean : mgStdevAskMean )
-                : mgFairValue) + (((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFV or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFVAPROff)
-                  ? mgStdevFV : (((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTops or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTopsAPROff)
+                : mgFairValue) + ((qp.quotingStdevProtection == mSTDEV::OnFV or qp.quotingStdevProtection == mSTDEV::OnFVAPROff)
+                  ? mgStdevFV : ((qp.quotingStdevProtection == mSTDEV::OnTops or qp.quotingStdevProtection == mSTDEV::OnTopsAPROff)
                     ? mgStdevTop : mgStdevAsk )),
               rawQuote.ask.price
             );
-          if (rawQuote.bid.price and ((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFV or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTops or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTop or pgSideAPR != "Buy")) {
+          if (rawQuote.bid.price and (qp.quotingStdevProtection == mSTDEV::OnFV or qp.quotingStdevProtection == mSTDEV::OnTops or qp.quotingStdevProtection == mSTDEV::OnTop or pgSideAPR != "Buy")) {
             rawQuote.bid.price = fmin(
-              (QP::getBool("quotingStdevBollingerBands")
-                ? ((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFV or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFVAPROff)
-                  ? mgStdevFVMean : (((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTops or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTopsAPROff)
+              (qp.quotingStdevBollingerBands
+                ? (qp.quotingStdevProtection == mSTDEV::OnFV or qp.quotingStdevProtection == mSTDEV::OnFVAPROff)
+                  ? mgStdevFVMean : ((qp.quotingStdevProtection == mSTDEV::OnTops or qp.quotingStdevProtection == mSTDEV::OnTopsAPROff)
                     ? mgStdevTopMean : mgStdevBidMean )
-                : mgFairValue) - (((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFV or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnFVAPROff)
-                  ? mgStdevFV : (((mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTops or (mSTDEV)QP::getInt("quotingStdevProtection") == mSTDEV::OnTopsAPROff)
+                : mgFairValue) - ((qp.quotingStdevProtection == mSTDEV::OnFV or qp.quotingStdevProtection == mSTDEV::OnFVAPROff)
+                  ? mgStdevFV : ((qp.quotingStdevProtection == mSTDEV::OnTops or qp.quotingStdevProtection == mSTDEV::OnTopsAPROff)
                     ? mgStdevTop : mgStdevBid )),
               rawQuote.bid.price
             );
@@ -344,42 +331,42 @@ namespace K {
         }
         else pgSideAPR = "Off";
         if (argDebugQuotes) FN::log("DEBUG", string("QE quote¿ ") + ((json)rawQuote).dump());
-        if ((mQuotingMode)QP::getInt("mode") == mQuotingMode::PingPong or QP::matchPings()) {
+        if (qp.mode == mQuotingMode::PingPong or QP::matchPings(qp)) {
           if (rawQuote.ask.size and safetyBuyPing and (
-            ((mAPR)QP::getInt("aggressivePositionRebalancing") == mAPR::SizeWidth and pgSideAPR == "Sell")
-            or (mPongAt)QP::getInt("pongAt") == mPongAt::ShortPingAggressive
-            or (mPongAt)QP::getInt("pongAt") == mPongAt::LongPingAggressive
+            (qp.aggressivePositionRebalancing == mAPR::SizeWidth and pgSideAPR == "Sell")
+            or qp.pongAt == mPongAt::ShortPingAggressive
+            or qp.pongAt == mPongAt::LongPingAggressive
             or rawQuote.ask.price < safetyBuyPing + widthPong
           )) rawQuote.ask.price = safetyBuyPing + widthPong;
           if (rawQuote.bid.size and safetySellPong and (
-            ((mAPR)QP::getInt("aggressivePositionRebalancing") == mAPR::SizeWidth and pgSideAPR == "Buy")
-            or (mPongAt)QP::getInt("pongAt") == mPongAt::ShortPingAggressive
-            or (mPongAt)QP::getInt("pongAt") == mPongAt::LongPingAggressive
+            (qp.aggressivePositionRebalancing == mAPR::SizeWidth and pgSideAPR == "Buy")
+            or qp.pongAt == mPongAt::ShortPingAggressive
+            or qp.pongAt == mPongAt::LongPingAggressive
             or rawQuote.bid.price > safetySellPong - widthPong
           )) rawQuote.bid.price = safetySellPong - widthPong;
         }
         if (argDebugQuotes) FN::log("DEBUG", string("QE quote¿ ") + ((json)rawQuote).dump());
-        if (QP::getBool("bestWidth")) {
+        if (qp.bestWidth) {
           if (rawQuote.ask.price)
-            for (vector<mLevel>::iterator it = mgLevelsFilter.asks.begin(); it != mgLevelsFilter.asks.end(); ++it)
-              if (it->price > rawQuote.ask.price) {
-                double bestAsk = it->price - gw->minTick;
+            for (map<long, mLevel>::iterator it = mgBook.asks.begin(); it != mgBook.asks.end(); ++it)
+              if (it->second.price > rawQuote.ask.price and mgBook.size(it->first, it->second.size)) {
+                double bestAsk = it->second.price - gw->minTick;
                 if (bestAsk > mgFairValue) {
                   rawQuote.ask.price = bestAsk;
                   break;
                 }
               }
           if (rawQuote.bid.price)
-            for (vector<mLevel>::iterator it = mgLevelsFilter.bids.begin(); it != mgLevelsFilter.bids.end(); ++it)
-              if (it->price < rawQuote.bid.price) {
-                double bestBid = it->price + gw->minTick;
+            for (map<long, mLevel>::iterator it = mgBook.bids.begin(); it != mgBook.bids.end(); ++it)
+              if (it->second.price < rawQuote.bid.price and mgBook.size(it->first, it->second.size)) {
+                double bestBid = it->second.price + gw->minTick;
                 if (bestBid < mgFairValue) {
                   rawQuote.bid.price = bestBid;
                   break;
                 }
               }
         }
-        if (safetySell > (QP::getDouble("tradesPerMinute") * superTradesMultipliers[0])) {
+        if (safetySell > (qp.tradesPerMinute * superTradesMultipliers[0])) {
           qeAskStatus = mQuoteState::MaxTradesSeconds;
           rawQuote.ask.price = 0;
           rawQuote.ask.size = 0;
@@ -397,9 +384,9 @@ namespace K {
           qeAskStatus = mQuoteState::DepletedFunds;
           FN::logWar("QE", string("SELL quote ignored: depleted ") + gw->base + " balance");
         }
-        if (((mQuotingMode)QP::getInt("mode") == mQuotingMode::PingPong or QP::matchPings())
-          and !safetyBuyPing and ((mPingAt)QP::getInt("pingAt") == mPingAt::StopPings or (mPingAt)QP::getInt("pingAt") == mPingAt::BidSide or (mPingAt)QP::getInt("pingAt") == mPingAt::DepletedAskSide
-            or (totalQuotePosition>buySize and ((mPingAt)QP::getInt("pingAt") == mPingAt::DepletedSide or (mPingAt)QP::getInt("pingAt") == mPingAt::DepletedBidSide))
+        if ((qp.mode == mQuotingMode::PingPong or QP::matchPings(qp))
+          and !safetyBuyPing and (qp.pingAt == mPingAt::StopPings or qp.pingAt == mPingAt::BidSide or qp.pingAt == mPingAt::DepletedAskSide
+            or (totalQuotePosition>buySize and (qp.pingAt == mPingAt::DepletedSide or qp.pingAt == mPingAt::DepletedBidSide))
         )) {
           qeAskStatus = !safetyBuyPing
             ? mQuoteState::WaitingPing
@@ -407,15 +394,15 @@ namespace K {
           rawQuote.ask.price = 0;
           rawQuote.ask.size = 0;
         }
-        if (safetyBuy > (QP::getDouble("tradesPerMinute") * superTradesMultipliers[0])) {
+        if (safetyBuy > (qp.tradesPerMinute * superTradesMultipliers[0])) {
           qeBidStatus = mQuoteState::MaxTradesSeconds;
           rawQuote.bid.price = 0;
           rawQuote.bid.size = 0;
         }
         if (argDebugQuotes) FN::log("DEBUG", string("QE quote¿ ") + ((json)rawQuote).dump());
-        if (((mQuotingMode)QP::getInt("mode") == mQuotingMode::PingPong or QP::matchPings())
-          and !safetySellPong and ((mPingAt)QP::getInt("pingAt") == mPingAt::StopPings or (mPingAt)QP::getInt("pingAt") == mPingAt::AskSide or (mPingAt)QP::getInt("pingAt") == mPingAt::DepletedBidSide
-            or (totalBasePosition>sellSize and ((mPingAt)QP::getInt("pingAt") == mPingAt::DepletedSide or (mPingAt)QP::getInt("pingAt") == mPingAt::DepletedAskSide))
+        if ((qp.mode == mQuotingMode::PingPong or QP::matchPings(qp))
+          and !safetySellPong and (qp.pingAt == mPingAt::StopPings or qp.pingAt == mPingAt::AskSide or qp.pingAt == mPingAt::DepletedBidSide
+            or (totalBasePosition>sellSize and (qp.pingAt == mPingAt::DepletedSide or qp.pingAt == mPingAt::DepletedAskSide))
         )) {
           qeBidStatus = !safetySellPong
             ? mQuoteState::WaitingPing
@@ -451,23 +438,24 @@ namespace K {
         return rawQuote;
       };
       static mQuote quote(double widthPing, double buySize, double sellSize) {
-        mQuotingMode k = (mQuotingMode)QP::getInt("mode");
+        mQuotingMode k = QP::get().mode;
         if (qeQuotingMode.find(k) == qeQuotingMode.end()) { FN::logErr("QE", "Invalid quoting mode"); exit(EXIT_FAILURE); }
         return (*qeQuotingMode[k])(widthPing, buySize, sellSize);
       };
       static mQuote quoteAtTopOfMarket() {
-        mLevel topBid = mgLevelsFilter.bids.begin()->size > gw->minTick
-          ? mgLevelsFilter.bids.at(0) : mgLevelsFilter.bids.at(mgLevelsFilter.bids.size()>1?1:0);
-        mLevel topAsk = mgLevelsFilter.asks.begin()->size > gw->minTick
-          ? mgLevelsFilter.asks.at(0) : mgLevelsFilter.asks.at(mgLevelsFilter.asks.size()>1?1:0);
+        mLevel topBid = mgBook.top(mSide::Bid);
+        if (topBid.size <= gw->minTick and mgBook.top(mSide::Bid, 1).price) topBid = mgBook.top(mSide::Bid, 1);
+        mLevel topAsk = mgBook.top(mSide::Ask);
+        if (topAsk.size <= gw->minTick and mgBook.top(mSide::Ask, 1).price) topAsk = mgBook.top(mSide::Ask, 1);
         return mQuote(topBid, topAsk);
       };
       static mQuote calcTopOfMarket(double widthPing, double buySize, double sellSize) {
+        const mQuotingParams &qp = QP::get();
         mQuote k = quoteAtTopOfMarket();
-        if ((mQuotingMode)QP::getInt("mode") != mQuotingMode::Join and k.bid.size > 0.2)
+        if (qp.mode != mQuotingMode::Join and k.bid.size > 0.2)
           k.bid.price = k.bid.price + gw->minTick;
         k.bid.price = fmin(mgFairValue - widthPing / 2.0, k.bid.price);
-        if ((mQuotingMode)QP::getInt("mode") != mQuotingMode::Join and k.ask.size > 0.2)
+        if (qp.mode != mQuotingMode::Join and k.ask.size > 0.2)
           k.ask.price = k.ask.price - gw->minTick;
         k.ask.price = fmin(mgFairValue + widthPing / 2.0, k.ask.price);
         k.bid.size = buySize;
@@ -481,7 +469,7 @@ namespace K {
           k.ask.price = k.ask.price + widthPing;
           k.bid.price = k.bid.price - widthPing;
         }
-        if ((mQuotingMode)QP::getInt("mode") == mQuotingMode::InverseTop) {
+        if (QP::get().mode == mQuotingMode::InverseTop) {
           if (k.bid.size > .2) k.bid.price = k.bid.price + gw->minTick;
           if (k.ask.size > .2) k.ask.price = k.ask.price - gw->minTick;
         }
@@ -505,17 +493,21 @@ namespace K {
                askSz = 0,
                askPx = 0;
         unsigned int maxLvl = 0;
-        for (vector<mLevel>::iterator it = mgLevelsFilter.bids.begin(); it != mgLevelsFilter.bids.end(); ++it) {
-          if (bidSz < it->size) {
-            bidSz = it->size;
-            bidPx = it->price;
+        for (map<long, mLevel>::iterator it = mgBook.bids.begin(); it != mgBook.bids.end(); ++it) {
+          double size = mgBook.size(it->first, it->second.size);
+          if (!size) continue;
+          if (bidSz < size) {
+            bidSz = size;
+            bidPx = it->second.price;
           }
           if (++maxLvl==13) break;
         }
-        for (vector<mLevel>::iterator it = mgLevelsFilter.asks.begin(); it != mgLevelsFilter.asks.end(); ++it) {
-          if (askSz < it->size) {
-            askSz = it->size;
-            askPx = it->price;
+        for (map<long, mLevel>::iterator it = mgBook.asks.begin(); it != mgBook.asks.end(); ++it) {
+          double size = mgBook.size(it->first, it->second.size);
+          if (!size) continue;
+          if (askSz < size) {
+            askSz = size;
+            askPx = it->second.price;
           }
           if (!--maxLvl) break;
         }
@@ -525,19 +517,19 @@ namespace K {
         );
       };
       static mQuote calcDepthOfMarket(double depth, double buySize, double sellSize) {
-        double bidPx = mgLevelsFilter.bids.begin()->price;
+        double bidPx = mgBook.top(mSide::Bid).price;
         double bidDepth = 0;
-        for (vector<mLevel>::iterator it = mgLevelsFilter.bids.begin(); it != mgLevelsFilter.bids.end(); ++it) {
-          bidDepth += it->size;
+        for (map<long, mLevel>::iterator it = mgBook.bids.begin(); it != mgBook.bids.end(); ++it) {
+          bidDepth += mgBook.size(it->first, it->second.size);
           if (bidDepth >= depth) break;
-          else bidPx = it->price;
+          else bidPx = it->second.price;
         }
-        double askPx = mgLevelsFilter.asks.begin()->price;
+        double askPx = mgBook.top(mSide::Ask).price;
         double askDepth = 0;
-        for (vector<mLevel>::iterator it = mgLevelsFilter.asks.begin(); it != mgLevelsFilter.asks.end(); ++it) {
-          askDepth += it->size;
+        for (map<long, mLevel>::iterator it = mgBook.asks.begin(); it != mgBook.asks.end(); ++it) {
+          askDepth += mgBook.size(it->first, it->second.size);
           if (askDepth >= depth) break;
-          else askPx = it->price;
+          else askPx = it->second.price;
         }
         return mQuote(
           mLevel(bidPx, buySize),
@@ -558,122 +550,105 @@ namespace K {
         return mQuoteState::Live;
      };
       static void updateQuote(mLevel q, mSide side, bool isPong) {
-        multimap<double, mOrder> orderSide = orderCacheSide(side);
-        bool eq = false;
-        for (multimap<double, mOrder>::iterator it = orderSide.begin(); it != orderSide.end(); ++it)
-          if (it->first == q.price) { eq = true; break; }
-        if ((mQuotingMode)QP::getInt("mode") != mQuotingMode::AK47) {
+        const mQuotingParams &qp = QP::get();
+        const multimap<long, mOrder*> &orderSide = OG::orders(side);
+        bool eq = orderSide.find(FN::ticks(q.price, gw->minTick)) != orderSide.end();
+        if (qp.mode != mQuotingMode::AK47) {
           if (orderSide.size()) {
             if (!eq) modify(side, q, isPong);
           } else start(side, q, isPong);
           return;
         }
-        if (!eq and orderSide.size() >= (size_t)QP::getInt("bullets"))
+        if (!eq and orderSide.size() >= qp.bullets)
           modify(side, q, isPong);
         else start(side, q, isPong);
       };
-      static multimap<double, mOrder> orderCacheSide(mSide side) {
-        multimap<double, mOrder> orderSide;
-        ogMutex.lock();
-        for (map<string, mOrder>::iterator it = allOrders.begin(); it != allOrders.end(); ++it)
-          if ((mSide)it->second.side == side)
-            orderSide.insert(pair<double, mOrder>(it->second.price, it->second));
-        ogMutex.unlock();
-        return orderSide;
+      static bool quoted(const multimap<long, mOrder*> &orderSide, double price, double range) {
+        multimap<long, mOrder*>::const_iterator it = orderSide.lower_bound(FN::ticks(price - fmax(0, range), gw->minTick));
+        return it != orderSide.end() and it->first <= FN::ticks(price + fmax(0, range), gw->minTick);
       };
       static void modify(mSide side, mLevel q, bool isPong) {
-        if ((mQuotingMode)QP::getInt("mode") == mQuotingMode::AK47)
+        if (QP::get().mode == mQuotingMode::AK47)
           stopWorstQuote(side);
         else stopAllQuotes(side);
         start(side, q, isPong);
       };
       static void start(mSide side, mLevel q, bool isPong) {
-        if (QP::getDouble("delayAPI")) {
-          unsigned long nextStart = qeNextT + (6e+4/QP::getDouble("delayAPI"));
-          if ((double)nextStart - (double)FN::T() > 0) {
+        const mQuotingParams &qp = QP::get();
+        if (qp.delayAPI) {
+          double wait = qeNextT + (6e+4/qp.delayAPI) - (double)FN::T();
+          if (wait > 0) {
             qeNextQuote.clear();
             qeNextQuote[side] = q;
-            thread([&]() {
-              unsigned int qeThread_ = ++qeThread;
-              unsigned long nextStart_ = nextStart;
-              bool isPong_ = isPong;
-              while (qeThread_ == qeThread) {
-                if (argDebugEvents) FN::log("DEBUG", "EV QE quote thread");
-                if ((double)nextStart_ - (double)FN::T() > 0)
-                  this_thread::sleep_for(chrono::milliseconds(100));
-                else {
-                  start(qeNextQuote.begin()->first, qeNextQuote.begin()->second, isPong_);
-                  break;
-                }
-              }
-            }).detach();
+            TM::cancel(qeTimer);
+            qeTimer = TM::once(wait * 1e+3, [isPong]() {
+              if (argDebugEvents) FN::log("DEBUG", "EV QE quote timer");
+              qeTimer = 0;
+              start(qeNextQuote.begin()->first, qeNextQuote.begin()->second, isPong);
+            });
             return;
           }
           qeNextT = FN::T();
         }
         double price = q.price;
-        multimap<double, mOrder> orderSide = orderCacheSide(side);
-        bool eq = false;
-        for (multimap<double, mOrder>::iterator it = orderSide.begin(); it != orderSide.end(); ++it)
-          if (price == it->first
-            or ((mQuotingMode)QP::getInt("mode") == mQuotingMode::AK47
-              and (price + (QP::getDouble("range") - 1e-2)) >= it->first
-              and (price - (QP::getDouble("range") - 1e-2)) <= it->first)
-          ) { eq = true; break; }
-        if (eq) {
-          if ((mQuotingMode)QP::getInt("mode") == mQuotingMode::AK47 and orderSide.size()<(size_t)QP::getInt("bullets")) {
-            double incPrice = (QP::getDouble("range") * (side == mSide::Bid ? -1 : 1 ));
+        const multimap<long, mOrder*> &orderSide = OG::orders(side);
+        if (quoted(orderSide, price, qp.mode == mQuotingMode::AK47 ? qp.range - 1e-2 : 0)) {
+          if (qp.mode == mQuotingMode::AK47 and orderSide.size()<qp.bullets) {
+            double incPrice = (qp.range * (side == mSide::Bid ? -1 : 1 ));
             double oldPrice = 0;
             unsigned int len = 0;
             if (side == mSide::Bid)
               calcAK47Increment(orderSide.begin(), orderSide.end(), &price, side, &oldPrice, incPrice, &len);
             else calcAK47Increment(orderSide.rbegin(), orderSide.rend(), &price, side, &oldPrice, incPrice, &len);
             if (len==orderSide.size()) price = incPrice + (side == mSide::Bid
-              ? orderSide.rbegin()->second.price
-              : orderSide.begin()->second.price);
-            eq = false;
-            for (multimap<double, mOrder>::iterator it = orderSide.begin(); it != orderSide.end(); ++it)
-              if (price == it->first
-                or ((price + (QP::getDouble("range") - 1e-2)) >= it->first
-                  and (price - (QP::getDouble("range") - 1e-2)) <= it->first)
-              ) { eq = true; break; }
-            if (eq) return;
+              ? orderSide.rbegin()->second->price
+              : orderSide.begin()->second->price);
+            if (quoted(orderSide, price, qp.range - 1e-2)) return;
             stopWorstsQuotes(side, q.price);
             price = FN::roundNearest(price, gw->minTick);
           } else return;
         }
         OG::sendOrder(side, price, q.size, mOrderType::Limit, mTimeInForce::GTC, isPong, true);
+        MT::record(mLatency::Send, mtQuote);
+        MT::record(mLatency::TickToTrade, mtTick);
       };
       template <typename Iterator> static void calcAK47Increment(Iterator iter, Iterator last, double* price, mSide side, double* oldPrice, double incPrice, unsigned int* len) {
         for (;iter != last; ++iter) {
-          if (*oldPrice>0 and (side == mSide::Bid?iter->first<*price:iter->first>*price)) {
+          double p = iter->second->price;
+          if (*oldPrice>0 and (side == mSide::Bid?p<*price:p>*price)) {
             *price = *oldPrice + incPrice;
-            if (abs(iter->first - *oldPrice)>incPrice) break;
+            if (abs(p - *oldPrice)>incPrice) break;
           }
-          *oldPrice = iter->first;
+          *oldPrice = p;
           ++(*len);
         }
       };
       static void stopWorstsQuotes(mSide side, double price) {
-        multimap<double, mOrder> orderSide = orderCacheSide(side);
-        for (multimap<double, mOrder>::iterator it = orderSide.begin(); it != orderSide.end(); ++it)
-          if (side == mSide::Bid
-            ? price < it->second.price
-            : price > it->second.price
-          ) OG::cancelOrder(it->second.orderId);
+        const multimap<long, mOrder*> &orderSide = OG::orders(side);
+        vector<string> k;
+        if (side == mSide::Bid)
+          for (multimap<long, mOrder*>::const_iterator it = orderSide.upper_bound(FN::ticks(price, gw->minTick)); it != orderSide.end(); ++it)
+            k.push_back(it->second->orderId);
+        else for (multimap<long, mOrder*>::const_iterator it = orderSide.begin(); it != orderSide.lower_bound(FN::ticks(price, gw->minTick)); ++it)
+          k.push_back(it->second->orderId);
+        for (vector<string>::iterator it = k.begin(); it != k.end(); ++it)
+          OG::cancelOrder(*it);
       };
       static void stopWorstQuote(mSide side) {
-        multimap<double, mOrder> orderSide = orderCacheSide(side);
+        const multimap<long, mOrder*> &orderSide = OG::orders(side);
         if (orderSide.size())
           OG::cancelOrder(side == mSide::Bid
-            ? orderSide.begin()->second.orderId
-            : orderSide.rbegin()->second.orderId
+            ? orderSide.begin()->second->orderId
+            : orderSide.rbegin()->second->orderId
           );
       };
       static void stopAllQuotes(mSide side) {
-        multimap<double, mOrder> orderSide = orderCacheSide(side);
-        for (multimap<double, mOrder>::iterator it = orderSide.begin(); it != orderSide.end(); ++it)
-          OG::cancelOrder(it->second.orderId);
+        const multimap<long, mOrder*> &orderSide = OG::orders(side);
+        vector<string> k;
+        for (multimap<long, mOrder*>::const_iterator it = orderSide.begin(); it != orderSide.end(); ++it)
+          k.push_back(it->second->orderId);
+        for (vector<string>::iterator it = k.begin(); it != k.end(); ++it)
+          OG::cancelOrder(*it);
       };
   };
 }
@@ -2,7 +2,9 @@
 #define K_QP_H_
 
 namespace K {
-  static json qp;
+  static json jsonQP;
+  static atomic<const mQuotingParams*> qpSnap(nullptr);
+  static vector<unique_ptr<const mQuotingParams>> qpOld; // readers may still hold a reference to a replaced snapshot, so keep them all (changes are rare).
   static json defQP {
     {  "widthPing",                     2                                      },
     {  "widthPingPercentage",           decimal_cast<2>("0.25").getAsDouble()  },
@@ -62,48 +64,51 @@ namespace K {
         UI::uiSnap(uiTXT::QuotingParametersChange, &onSnap);
         UI::uiHand(uiTXT::QuotingParametersChange, &onHand);
       }
-      static bool matchPings() {
-        mQuotingMode k = (mQuotingMode)getInt("mode");
-        return k == mQuotingMode::Boomerang
-            or k == mQuotingMode::HamelinRat
-            or k == mQuotingMode::AK47;
+      static const mQuotingParams &get() {
+        return *qpSnap.load(memory_order_acquire);
       };
+      static bool matchPings(const mQuotingParams &qp = get()) {
+        return qp.mode == mQuotingMode::Boomerang
+            or qp.mode == mQuotingMode::HamelinRat
+            or qp.mode == mQuotingMode::AK47;
+      };
+    private:
+      friend class BM;
       static bool getBool(string k) {
-        if (!qp[k].is_boolean()) {
+        if (!jsonQP[k].is_boolean()) {
           FN::log("QP", k + " is not boolean, get a false instead");
           return false;
         }
-        return qp[k].get<bool>();
+        return jsonQP[k].get<bool>();
       };
       static int getInt(string k) {
-        if (!qp[k].is_number()) {
+        if (!jsonQP[k].is_number()) {
           FN::log("QP", k + " is not numeric, get a 0 instead");
           return 0;
         }
-        return qp[k].get<int>();
+        return jsonQP[k].get<int>();
       };
       static double getDouble(string k) {
-        if (!qp[k].is_number()) {
+        if (!jsonQP[k].is_number()) {
           FN::log("QP", k + " is not numeric, get a 0 instead");
           return 0;
         }
-        return qp[k].get<double>();
+        return jsonQP[k].get<double>();
       };
-    private:
       static void load() {
-        qp = defQP;
+        jsonQP = defQP;
         json qp_ = DB::load(uiTXT::QuotingParametersChange);
         if (qp_.size()) {
           qp_ = qp_.at(0);
           for (json::iterator it = qp_.begin(); it != qp_.end(); ++it)
-            qp[it.key()] = it.value();
+            jsonQP[it.key()] = it.value();
         }
         clean();
-        UI::delay(getDouble("delayUI"));
+        UI::delay(get().delayUI);
         FN::log("DB", string("loaded Quoting Parameters ") + (qp_.size() ? "OK" : "OR reading defaults instead"));
       };
       static json onSnap() {
-        return { qp };
+        return { jsonQP };
       };
       static void onHand(json k) {
         if (k.value("buySize", 0.0) > 0
@@ -117,17 +122,69 @@ namespace K {
         ) {
           if ((mQuotingMode)k.value("mode", 0) == mQuotingMode::Depth)
             k["widthPercentage"] = false;
-          qp = k;
+          jsonQP = k;
           clean();
           DB::insert(uiTXT::QuotingParametersChange, k);
           ev_uiQuotingParameters();
-          UI::delay(getDouble("delayUI"));
+          UI::delay(get().delayUI);
         }
         UI::uiSend(uiTXT::QuotingParametersChange, k);
       };
       static void clean() {
         for (vector<string>::const_iterator it = boolQP.begin(); it != boolQP.end(); ++it)
-          if (qp[*it].is_number()) qp[*it] = qp[*it].get<int>() != 0;
+          if (jsonQP[*it].is_number()) jsonQP[*it] = jsonQP[*it].get<int>() != 0;
+        compile();
+      };
+      static void compile() {
+        mQuotingParams *k = new mQuotingParams();
+        k->widthPing = getDouble("widthPing");
+        k->widthPingPercentage = getDouble("widthPingPercentage");
+        k->widthPong = getDouble("widthPong");
+        k->widthPongPercentage = getDouble("widthPongPercentage");
+        k->widthPercentage = getBool("widthPercentage");
+        k->bestWidth = getBool("bestWidth");
+        k->buySize = getDouble("buySize");
+        k->buySizePercentage = getDouble("buySizePercentage");
+        k->buySizeMax = getBool("buySizeMax");
+        k->sellSize = getDouble("sellSize");
+        k->sellSizePercentage = getDouble("sellSizePercentage");
+        k->sellSizeMax = getBool("sellSizeMax");
+        k->pingAt = (mPingAt)getInt("pingAt");
+        k->pongAt = (mPongAt)getInt("pongAt");
+        k->mode = (mQuotingMode)getInt("mode");
+        k->bullets = getInt("bullets");
+        k->range = getDouble("range");
+        k->fvModel = (mFairValueModel)getInt("fvModel");
+        k->targetBasePosition = getDouble("targetBasePosition");
+        k->targetBasePositionPercentage = getDouble("targetBasePositionPercentage");
+        k->positionDivergence = getDouble("positionDivergence");
+        k->positionDivergencePercentage = getDouble("positionDivergencePercentage");
+        k->percentageValues = getBool("percentageValues");
+        k->autoPositionMode = (mAutoPositionMode)getInt("autoPositionMode");
+        k->aggressivePositionRebalancing = (mAPR)getInt("aggressivePositionRebalancing");
+        k->superTrades = (mSOP)getInt("superTrades");
+        k->tradesPerMinute = getDouble("tradesPerMinute");
+        k->tradeRateSeconds = getDouble("tradeRateSeconds");
+        k->quotingEwmaProtection = getBool("quotingEwmaProtection");
+        k->quotingEwmaProtectionPeriods = getInt("quotingEwmaProtectionPeriods");
+        k->quotingStdevProtection = (mSTDEV)getInt("quotingStdevProtection");
+        k->quotingStdevBollingerBands = getBool("quotingStdevBollingerBands");
+        k->quotingStdevProtectionFactor = getDouble("quotingStdevProtectionFactor");
+        k->quotingStdevProtectionPeriods = getInt("quotingStdevProtectionPeriods");
+        k->ewmaSensiblityPercentage = getDouble("ewmaSensiblityPercentage");
+        k->longEwmaPeriods = getInt("longEwmaPeriods");
+        k->mediumEwmaPeriods = getInt("mediumEwmaPeriods");
+        k->shortEwmaPeriods = getInt("shortEwmaPeriods");
+        k->aprMultiplier = getInt("aprMultiplier");
+        k->sopWidthMultiplier = getInt("sopWidthMultiplier");
+        k->delayAPI = getDouble("delayAPI");
+        k->cancelOrdersAuto = getBool("cancelOrdersAuto");
+        k->cleanPongsAuto = getDouble("cleanPongsAuto");
+        k->profitHourInterval = getDouble("profitHourInterval");
+        k->audio = getBool("audio");
+        k->delayUI = getDouble("delayUI");
+        qpOld.push_back(unique_ptr<const mQuotingParams>(k));
+        qpSnap.store(k, memory_order_release);
       };
   };
 }
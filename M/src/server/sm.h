@@ -0,0 +1,232 @@
+#ifndef K_SM_H_
+#define K_SM_H_
+
+namespace K {
+  struct smOrder {
+    string id;
+     mSide side;
+    double price,
+           quantity,
+           filled;
+    smOrder():
+      id(""), side(mSide::Unknown), price(0), quantity(0), filled(0)
+    {};
+    smOrder(string i, mSide s, double p, double q):
+      id(i), side(s), price(p), quantity(q), filled(0)
+    {};
+  };
+  struct smAction {
+    unsigned long time;
+             bool cancel;
+          smOrder order;
+    smAction(unsigned long t, bool c, smOrder o):
+      time(t), cancel(c), order(o)
+    {};
+  };
+  class GwSim: public Gw {
+    public:
+      mExchange config() {
+        exchange = mExchange::Sim;
+        symbol = base + quote;
+        minTick = 0.01;
+        minSize = 0.001;
+        return exchange;
+      };
+      string randId() {
+        return FN::uid();
+      };
+      void wallet() {};
+      void levels() {
+        ev_gwConnectMarket(mConnectivity::Connected);
+        ev_gwConnectOrder(mConnectivity::Connected);
+        fund(1, 1000);
+        unsigned long T = FN::Tns(),
+                      n = 0;
+        while (open) {
+          process();
+          flow();
+          if (++n % 1000 == 0 and argDebugOrders) FN::log("SIM", to_string(n * 1e+9 / (FN::Tns() - T)) + " events/s");
+          if (argSimRate) this_thread::sleep_for(chrono::microseconds(1000000 / argSimRate));
+        }
+      };
+      void send(string oI, mSide oS, double oP, double oQ, mOrderType oLM, mTimeInForce oTIF, bool oPO, unsigned long oT) {
+        lock_guard<mutex> lock(smMutex);
+        inbox.push_back(smAction(FN::T() + argSimLatency, false, smOrder(oI, oS, oP, oQ)));
+      };
+      void cancel(string oI, string oE, mSide oS, unsigned long oT) {
+        lock_guard<mutex> lock(smMutex);
+        inbox.push_back(smAction(FN::T() + argSimLatency, true, smOrder(oI, oS, 0, 0)));
+      };
+      void cancelAll() {
+        lock_guard<mutex> lock(smMutex);
+        inbox.push_back(smAction(FN::T() + argSimLatency, true, smOrder()));
+      };
+      void freeSockets() {
+        open = false;
+      };
+    protected:
+      map<long, deque<smOrder>> bids, // keyed by -tick, so begin() is the best bid
+                                asks;
+      map<string, smOrder> own;
+      map<string, double> wallets;
+      bool trades = true;
+      unsigned long sent = 0,
+                    fills = 0;
+      void process() {
+        vector<smAction> k;
+        smMutex.lock();
+        while (!inbox.empty() and inbox.front().time <= FN::T()) {
+          k.push_back(inbox.front());
+          inbox.pop_front();
+        }
+        smMutex.unlock();
+        for (vector<smAction>::iterator it = k.begin(); it != k.end(); ++it)
+          if (it->cancel and it->order.id == "") {
+            vector<string> ids;
+            for (map<string, smOrder>::iterator it_ = own.begin(); it_ != own.end(); ++it_)
+              ids.push_back(it_->first);
+            for (vector<string>::iterator it_ = ids.begin(); it_ != ids.end(); ++it_)
+              remove(*it_);
+          } else if (it->cancel) remove(it->order.id);
+          else {
+            ++sent;
+            own[it->order.id] = it->order;
+            reply(it->order, mORS::Working, 0);
+            add(it->order);
+          }
+        if (k.size()) publish();
+      };
+      void add(smOrder o, bool rest = true) {
+        map<long, deque<smOrder>> &book = o.side == mSide::Bid ? asks : bids;
+        while (o.quantity > o.filled and !book.empty()) {
+          deque<smOrder> &level = book.begin()->second;
+          smOrder &maker = level.front();
+          if (o.price and (o.side == mSide::Bid ? maker.price > o.price : maker.price < o.price)) break;
+          double qty = fmin(o.quantity - o.filled, maker.quantity - maker.filled);
+          o.filled += qty;
+          maker.filled += qty;
+          if (trades) ev_gwDataTrade(mTrade(maker.price, qty, o.side));
+          if (maker.id != "") fill(maker, qty);
+          if (o.id != "") {
+            smOrder taker = o;
+            taker.price = maker.price;
+            fill(taker, qty);
+          }
+          if (maker.filled >= maker.quantity) {
+            level.pop_front();
+            if (level.empty()) book.erase(book.begin());
+          }
+        }
+        if (rest and o.price and o.quantity > o.filled)
+          (o.side == mSide::Bid ? bids : asks)[tick(o.side, o.price)].push_back(o);
+      };
+      void fund(double b, double q) {
+        wallets[base] = b;
+        wallets[quote] = q;
+        ev_gwDataWallet(mWallet(wallets[base], 0, base));
+        ev_gwDataWallet(mWallet(wallets[quote], 0, quote));
+      };
+      void publish() {
+        mLevels k;
+        for (map<long, deque<smOrder>>::iterator it = bids.begin(); it != bids.end() and k.bids.size() < 20; ++it)
+          k.bids.push_back(mLevel(it->second.front().price, size(it->second)));
+        for (map<long, deque<smOrder>>::iterator it = asks.begin(); it != asks.end() and k.asks.size() < 20; ++it)
+          k.asks.push_back(mLevel(it->second.front().price, size(it->second)));
+        ev_gwDataLevels(k);
+      };
+      void level(mSide side, double price, double qty) {
+        map<long, deque<smOrder>> &book = side == mSide::Bid ? bids : asks;
+        map<long, deque<smOrder>>::iterator it = book.find(tick(side, price));
+        if (it != book.end()) {
+          for (deque<smOrder>::iterator it_ = it->second.begin(); it_ != it->second.end();)
+            if (it_->id == "") it_ = it->second.erase(it_); else ++it_;
+          if (it->second.empty()) book.erase(it);
+        }
+        if (qty > 0) add(smOrder("", side, price, qty));
+      };
+      void clear() {
+        map<long, deque<smOrder>> *books[] = {&bids, &asks};
+        for (int i = 0; i < 2; ++i)
+          for (map<long, deque<smOrder>>::iterator it = books[i]->begin(); it != books[i]->end();) {
+            for (deque<smOrder>::iterator it_ = it->second.begin(); it_ != it->second.end();)
+              if (it_->id == "") it_ = it->second.erase(it_); else ++it_;
+            if (it->second.empty()) it = books[i]->erase(it); else ++it;
+          }
+      };
+      long tick(mSide side, double price) {
+        long k = llround(price / minTick);
+        return side == mSide::Bid ? -k : k;
+      };
+    private:
+      mutex smMutex;
+      deque<smAction> inbox;
+      atomic<bool> open{true};
+      mt19937 random{1};
+      double mid = 1000;
+      void flow() {
+        uniform_real_distribution<double> u(0, 1);
+        mid = fmax(minTick, mid + normal_distribution<double>(0, minTick)(random));
+        double k = u(random),
+               qty = fmax(minSize, FN::roundNearest(u(random), minSize));
+        mSide side = u(random) < .5 ? mSide::Bid : mSide::Ask;
+        if (k < .6) {
+          double price = FN::roundNearest(mid + (side == mSide::Bid ? -1 : 1) * minTick * (1 + (int)(u(random) * 20)), minTick);
+          add(smOrder("", side, price, qty));
+        } else if (k < .85) add(smOrder("", side, 0, qty));
+        else {
+          map<long, deque<smOrder>> &book = side == mSide::Bid ? bids : asks;
+          map<long, deque<smOrder>>::iterator it = book.end();
+          while (book.size() > 30 and it != book.begin()) {
+            --it;
+            for (deque<smOrder>::iterator it_ = it->second.begin(); it_ != it->second.end();)
+              if (it_->id == "") it_ = it->second.erase(it_); else ++it_;
+            if (it->second.empty()) it = book.erase(it);
+          }
+        }
+        publish();
+      };
+      void remove(string id) {
+        map<string, smOrder>::iterator it = own.find(id);
+        if (it == own.end()) return;
+        map<long, deque<smOrder>> &book = it->second.side == mSide::Bid ? bids : asks;
+        map<long, deque<smOrder>>::iterator it_ = book.find(tick(it->second.side, it->second.price));
+        if (it_ != book.end()) {
+          for (deque<smOrder>::iterator it__ = it_->second.begin(); it__ != it_->second.end(); ++it__)
+            if (it__->id == id) { it_->second.erase(it__); break; }
+          if (it_->second.empty()) book.erase(it_);
+        }
+        smOrder o = it->second;
+        own.erase(it);
+        reply(o, mORS::Cancelled, 0);
+      };
+      void fill(const smOrder &o, double qty) {
+        map<string, smOrder>::iterator it = own.find(o.id);
+        if (it == own.end()) return;
+        it->second.filled += qty;
+        ++fills;
+        double sign = o.side == mSide::Bid ? 1 : -1;
+        wallets[base] += sign * qty;
+        wallets[quote] -= sign * qty * o.price;
+        mORS status = it->second.filled >= it->second.quantity ? mORS::Complete : mORS::Working;
+        smOrder k = it->second;
+        k.price = o.price;
+        if (status == mORS::Complete) own.erase(it);
+        reply(k, status, qty);
+        ev_gwDataWallet(mWallet(wallets[base], 0, base));
+        ev_gwDataWallet(mWallet(wallets[quote], 0, quote));
+      };
+      void reply(const smOrder &o, mORS status, double qty) {
+        mOrder k(o.id, o.id, status, o.price, o.quantity, qty);
+        k.side = o.side;
+        ev_gwDataOrder(k);
+      };
+      double size(const deque<smOrder> &k) {
+        double size = 0;
+        for (deque<smOrder>::const_iterator it = k.begin(); it != k.end(); ++it)
+          size += it->quantity - it->filled;
+        return size;
+      };
+  };
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef K_TM_H_
+#define K_TM_H_
+
+namespace K {
+  struct tmTimer {
+    unsigned long T,
+                  period;
+             bool engine;
+    function<void()> fn;
+  };
+  static const unsigned int tmBits = 8,
+                            tmSlots = 1 << tmBits,
+                            tmLevels = 4;
+  static const unsigned long tmTick = 1 << 17; // ns, ~131us per slot on the lowest level
+  static vector<unsigned long> tmWheel[tmLevels][tmSlots];
+  static map<unsigned long, tmTimer> tmTimers;
+  static unsigned long tmNow = 0,
+                       tmIds = 0;
+  static mutex tmMutex;
+  static condition_variable tmCond;
+  static void (*tmDispatch)(function<void()>) = nullptr;
+  class TM {
+    public:
+      static unsigned long once(unsigned long us, function<void()> fn, bool engine = true) {
+        return add(us, 0, fn, engine);
+      };
+      static unsigned long every(unsigned long us, function<void()> fn, bool engine = true) {
+        return add(us, us, fn, engine);
+      };
+      static void cancel(unsigned long id) {
+        if (!id) return;
+        lock_guard<mutex> lock(tmMutex);
+        tmTimers.erase(id);
+      };
+      static void replay(unsigned long T) { // runs the timers due by the journal time T (ms) on the caller's thread, in order
+        while (true) {
+          function<void()> fn;
+          {
+            lock_guard<mutex> lock(tmMutex);
+            map<unsigned long, tmTimer>::iterator next = tmTimers.end();
+            for (map<unsigned long, tmTimer>::iterator it = tmTimers.begin(); it != tmTimers.end(); ++it)
+              if (it->second.T <= T * 1000000 and (next == tmTimers.end() or it->second.T < next->second.T)) next = it;
+            if (next == tmTimers.end()) return;
+            FN::T(next->second.T / 1000000);
+            fn = next->second.fn;
+            if (next->second.period) next->second.T += next->second.period;
+            else tmTimers.erase(next);
+          }
+          fn();
+        }
+      };
+    private:
+      static unsigned long add(unsigned long us, unsigned long period, function<void()> fn, bool engine) {
+        unsigned long id;
+        if (argReplay != "") {
+          lock_guard<mutex> lock(tmMutex);
+          id = ++tmIds;
+          tmTimers[id] = {FN::T() * 1000000 + us * 1000, period * 1000, engine, fn};
+          return id;
+        }
+        static once_flag running;
+        call_once(running, []() {
+          tmNow = FN::Tns() / tmTick;
+          thread([&]() { wheel(); }).detach();
+        });
+        {
+          lock_guard<mutex> lock(tmMutex);
+          id = ++tmIds;
+          tmTimers[id] = {FN::Tns() + us * 1000, period * 1000, engine, fn};
+          place(id, tmTimers[id].T, tmNow + 1);
+        }
+        tmCond.notify_one();
+        return id;
+      };
+      static void place(unsigned long id, unsigned long T, unsigned long floor) {
+        unsigned long k = max(T / tmTick, floor);
+        for (unsigned int i = 0; i < tmLevels; ++i)
+          if ((k ^ tmNow) >> (tmBits * (i + 1)) == 0)
+            return tmWheel[i][(k >> (tmBits * i)) & (tmSlots - 1)].push_back(id);
+        tmWheel[tmLevels - 1][((tmNow >> (tmBits * (tmLevels - 1))) - 1) & (tmSlots - 1)].push_back(id);
+      };
+      static void cascade(unsigned int level) {
+        vector<unsigned long> ids;
+        ids.swap(tmWheel[level][(tmNow >> (tmBits * level)) & (tmSlots - 1)]);
+        for (vector<unsigned long>::iterator it = ids.begin(); it != ids.end(); ++it) {
+          map<unsigned long, tmTimer>::iterator it_ = tmTimers.find(*it);
+          if (it_ != tmTimers.end()) place(*it, it_->second.T, tmNow);
+        }
+      };
+      static void wheel() {
+        vector<tmTimer> due;
+        unique_lock<mutex> lock(tmMutex);
+        while (true) {
+          unsigned long now = FN::Tns() / tmTick;
+          while (tmNow < now) {
+            ++tmNow;
+            unsigned int top = 0;
+            while (top + 1 < tmLevels and (tmNow & ((1UL << (tmBits * (top + 1))) - 1)) == 0) ++top;
+            for (unsigned int i = top; i > 0; --i) cascade(i);
+            vector<unsigned long> ids;
+            ids.swap(tmWheel[0][tmNow & (tmSlots - 1)]);
+            for (vector<unsigned long>::iterator it = ids.begin(); it != ids.end(); ++it) {
+              map<unsigned long, tmTimer>::iterator it_ = tmTimers.find(*it);
+              if (it_ == tmTimers.end()) continue;
+              if (it_->second.T / tmTick > tmNow) { place(*it, it_->second.T, tmNow + 1); continue; }
+              due.push_back(it_->second);
+              if (it_->second.period) {
+                it_->second.T += it_->second.period;
+                place(*it, it_->second.T, tmNow + 1);
+              } else tmTimers.erase(it_);
+            }
+          }
+          if (!due.empty()) {
+            lock.unlock();
+            for (vector<tmTimer>::iterator it = due.begin(); it != due.end(); ++it)
+              if (it->engine and tmDispatch) tmDispatch(it->fn);
+              else it->fn();
+            due.clear();
+            lock.lock();
+            continue;
+          }
+          if (tmTimers.empty()) { tmCond.wait(lock); continue; }
+          unsigned long next = (tmNow | (tmSlots - 1)) + 1;
+          for (unsigned long i = tmNow + 1; i < next; ++i)
+            if (!tmWheel[0][i & (tmSlots - 1)].empty()) { next = i; break; }
+          tmCond.wait_until(lock, chrono::steady_clock::time_point(chrono::nanoseconds(next * tmTick)));
+        }
+      };
+  };
+}
+
+#endif
@@ -13,90 +13,151 @@ namespace K {
   static double ui_delayUI = 0;
   static string uiNOTE = "";
   static string uiNK64 = "";
+  static void (*uiDispatch)(uiMsg_, json) = nullptr;
+  static json (*uiSnapDispatch)(uiSnap_) = nullptr;
+  static z_stream *uiZ = nullptr;
+  static const uintptr_t uiDeflate = 1,
+                         uiMsgpack = 2;
+  static const unsigned int uiQueueMax = 256; // batches a client may leave unwritten before we drop it
+  struct uiConn { // per socket state, kept as the socket's user data
+        uintptr_t flags;
+      bitset<128> topics;
+    atomic<unsigned int> queued;
+    unsigned long rate,
+                  T,
+                  seq,
+                  book;
+             bool delta;
+    map<long, mLevel> bids,
+                      asks;
+    uiConn(uintptr_t f):
+      flags(f), queued(0), rate(369), T(0), seq(0), book(0), delta(false)
+    {};
+  };
+  static atomic<unsigned int> uiSubs[128];
+  static unsigned long uiBook = 0;
+  static thread_local bool uiClosing = false;
+  struct uiFile { // complete http responses, built once per file
+    string etag,
+           plain,
+           gzip,
+           notModified;
+  };
+  static shared_ptr<const map<string, uiFile>> uiFiles = make_shared<const map<string, uiFile>>();
+  static int uiNotify = -1;
   class UI {
     public:
       static void main() {
         if (!argHeadless) {
           uiGroup->setUserData(new uiSess);
+          uiZ = new z_stream();
+          if (deflateInit2(uiZ, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            delete uiZ;
+            uiZ = nullptr;
+          }
           uiSess *sess = (uiSess *) uiGroup->getUserData();
           if (argUser != "NULL" && argPass != "NULL" && argUser.length() > 0 && argPass.length() > 0) {
             B64::Encode(argUser + ':' + argPass, &uiNK64);
             uiNK64 = string("Basic ") + uiNK64;
           }
           uiGroup->onConnection([sess](uWS::WebSocket<uWS::SERVER> *webSocket, uWS::HttpRequest req) {
+            lock_guard<mutex> lock(wsMutex);
             sess->u++;
+            webSocket->setUserData(new uiConn(
+              (req.getHeader("sec-websocket-extensions").toString().find("permessage-deflate") != string::npos ? uiDeflate : 0)
+              | (req.getUrl().toString().find("msgpack") != string::npos ? uiMsgpack : 0)
+            ));
             typename uWS::WebSocket<uWS::SERVER>::Address address = webSocket->getAddress();
             FN::logUIsess(sess->u, address.address);
           });
           uiGroup->onDisconnection([sess](uWS::WebSocket<uWS::SERVER> *webSocket, int code, char *message, size_t length) {
+            unique_lock<mutex> lock(wsMutex, defer_lock);
+            if (!uiClosing) lock.lock();
             sess->u--;
+            uiConn *c = (uiConn*)webSocket->getUserData();
+            for (unsigned int i = 0; c and i < c->topics.size(); ++i)
+              if (c->topics[i]) uiSubs[i]--;
+            delete c;
+            webSocket->setUserData(nullptr);
             typename uWS::WebSocket<uWS::SERVER>::Address address = webSocket->getAddress();
             FN::logUIsess(sess->u, address.address);
           });
+          files();
           uiGroup->onHttpRequest([&](uWS::HttpResponse *res, uWS::HttpRequest req, char *data, size_t length, size_t remainingBytes) {
-            string document;
-            string auth = req.getHeader("authorization").toString();
-            typename uWS::WebSocket<uWS::SERVER>::Address address = res->getHttpSocket()->getAddress();
-            if (uiNK64 != "" && auth == "") {
-              FN::log("UI", "authorization attempt from", address.address);
-              document = "HTTP/1.1 401 Unauthorized\r\nWWW-Authenticate: Basic realm=\"Basic Authorization\"\r\nConnection: keep-alive\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\nContent-Type:text/plain; charset=UTF-8\r\nContent-Length: 0\r\n\r\n";
-              res->write(document.data(), document.length());
-            } else if (uiNK64 != "" && auth != uiNK64) {
-              FN::log("UI", "authorization failed from", address.address);
-              document = "HTTP/1.1 403 Forbidden\r\nConnection: keep-alive\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\nContent-Type:text/plain; charset=UTF-8\r\nContent-Length: 0\r\n\r\n";
-              res->write(document.data(), document.length());
+            static const string unauthorized = "HTTP/1.1 401 Unauthorized\r\nWWW-Authenticate: Basic realm=\"Basic Authorization\"\r\nConnection: keep-alive\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\nContent-Type:text/plain; charset=UTF-8\r\nContent-Length: 0\r\n\r\n",
+                                forbidden = "HTTP/1.1 403 Forbidden\r\nConnection: keep-alive\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\nContent-Type:text/plain; charset=UTF-8\r\nContent-Length: 0\r\n\r\n";
+            static thread_local string path;
+            uWS::Header auth = req.getHeader("authorization");
+            if (uiNK64 != "" && !auth) {
+              FN::log("UI", "authorization attempt from", res->getHttpSocket()->getAddress().address);
+              res->write(unauthorized.data(), unauthorized.length());
+            } else if (uiNK64 != "" && (auth.valueLength != uiNK64.length() or strncmp(auth.value, uiNK64.data(), auth.valueLength))) {
+              FN::log("UI", "authorization failed from", res->getHttpSocket()->getAddress().address);
+              res->write(forbidden.data(), forbidden.length());
             } else if (req.getMethod() == uWS::HttpMethod::METHOD_GET) {
-              string url = "";
-              document = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\nCache-Control: public, max-age=0\r\n";
-              string path = req.getUrl().toString();
-              string::size_type n = 0;
-              while ((n = path.find("..", n)) != string::npos) path.replace(n, 2, "");
-              const string leaf = path.substr(path.find_last_of('.')+1);
-              if (leaf == "/") {
-                FN::log("UI", "authorization success from", address.address);
-                document += "Content-Type: text/html; charset=UTF-8\r\n";
-                url = "/index.html";
-              } else if (leaf == "js") {
-                document += "Content-Type: application/javascript; charset=UTF-8\r\nContent-Encoding: gzip\r\n";
-                url = path;
-              } else if (leaf == "css") {
-                document += "Content-Type: text/css; charset=UTF-8\r\n";
-                url = path;
-              } else if (leaf == "png") {
-                document += "Content-Type: image/png\r\n";
-                url = path;
-              } else if (leaf == "mp3") {
-                document += "Content-Type: audio/mpeg\r\n";
-                url = path;
+              uWS::Header url = req.getUrl();
+              path.assign(url.value, find(url.value, url.value + url.valueLength, '?') - url.value);
+              if (path == "/") {
+                FN::log("UI", "authorization success from", res->getHttpSocket()->getAddress().address);
+                path = "/index.html";
+              }
+              shared_ptr<const map<string, uiFile>> cache = atomic_load(&uiFiles);
+              map<string, uiFile>::const_iterator it = cache->find(path);
+              if (it != cache->end()) {
+                const string &k = contains(req.getHeader("if-none-match"), it->second.etag)
+                  ? it->second.notModified
+                  : (it->second.gzip.empty() or (!it->second.plain.empty() and !contains(req.getHeader("accept-encoding"), "gzip"))
+                    ? it->second.plain : it->second.gzip);
+                return res->write(k.data(), k.length());
               }
-              stringstream content;
-              if (url.length() > 0) content << ifstream(FN::readlink("app/client").substr(3) + url).rdbuf();
-              else {
+              string document, content;
+              if (path == "/metrics") {
+                document = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nContent-Type: text/plain; version=0.0.4; charset=UTF-8\r\n";
+                content = MT::metrics();
+              } else {
                 struct timespec txxs;
                 clock_gettime(CLOCK_MONOTONIC, &txxs);
                 srand((time_t)txxs.tv_nsec);
                 if (rand() % 21) {
                   document = "HTTP/1.1 404 Not Found\r\n";
-                  content << "Today, is a beautiful day.";
+                  content = "Today, is a beautiful day.";
                 } else { // Humans! go to any random url to check your luck
                   document = "HTTP/1.1 418 I'm a teapot\r\n";
-                  content << "Today, is your lucky day!";
+                  content = "Today, is your lucky day!";
                 }
               }
-              document += "Content-Length: " + to_string(content.str().length()) + "\r\n\r\n" + content.str();
+              document += "Content-Length: " + to_string(content.length()) + "\r\n\r\n" + content;
               res->write(document.data(), document.length());
             }
           });
           uiGroup->onMessage([sess](uWS::WebSocket<uWS::SERVER> *webSocket, const char *message, size_t length, uWS::OpCode opCode) {
             if (length > 1) {
               json v;
-              if (length > 2 and (message[2] == '[' or message[2] == '{'))
-                v = json::parse(string(message, length).substr(2, length-2).data());
+              try {
+                if (length > 2 and opCode == uWS::OpCode::BINARY)
+                  v = json::from_msgpack(vector<uint8_t>(message, message + length), 2);
+                else if (length > 2 and uiBIT::MSG == (uiBIT)message[0] and (message[2] == '[' or message[2] == '{'))
+                  v = json::parse(message + 2, message + length);
+              } catch (const exception &e) {
+                FN::logWar("UI", string("Closing a client that sent an unreadable message: ") + e.what());
+                webSocket->close(1007);
+                return;
+              }
+              if (uiBIT::SNAP == (uiBIT)message[0]) subscribe((uiConn*)webSocket->getUserData(), (uiTXT)message[1],
+                v.is_object() ? rate(v) : rate(message + 2, length - 2)
+              );
               if (uiBIT::SNAP == (uiBIT)message[0] and sess->cbSnap.find(message[1]) != sess->cbSnap.end()) {
-                json reply = (*sess->cbSnap[message[1]])();
-                if (!reply.is_null()) webSocket->send(string(message, 2).append(reply.dump()).data(), uWS::OpCode::TEXT);
-              } else if (uiBIT::MSG == (uiBIT)message[0] and sess->cbMsg.find(message[1]) != sess->cbMsg.end())
-                (*sess->cbMsg[message[1]])(v);
+                json reply = uiSnapDispatch
+                  ? uiSnapDispatch(sess->cbSnap[message[1]])
+                  : (*sess->cbSnap[message[1]])();
+                if (reply.is_null()) return;
+                bool binary = ((uiConn*)webSocket->getUserData())->flags & uiMsgpack;
+                string m = encode(string(message, 2), reply, binary);
+                webSocket->send(m.data(), m.length(), binary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT);
+              } else if (uiBIT::MSG == (uiBIT)message[0] and sess->cbMsg.find(message[1]) != sess->cbMsg.end()) {
+                if (uiDispatch) uiDispatch(sess->cbMsg[message[1]], v);
+                else (*sess->cbMsg[message[1]])(v);
+              }
             }
           });
           uS::TLS::Context c = uS::TLS::createContext("etc/sslcert/server.crt", "etc/sslcert/server.key", "");
@@ -106,12 +167,14 @@ namespace K {
             uiPrtcl = "HTTP";
           else { FN::logErr("IU", string("Use another UI port number, ") + to_string(argPort) + " seems already in use by:\n" + FN::output(string("netstat -anp 2>/dev/null | grep ") + to_string(argPort)) + "\n"); exit(EXIT_SUCCESS); }
           FN::logUI(uiPrtcl, argPort);
+          if (argReplay == "") TM::every(25e+3, &book);
         }
         UI::uiSnap(uiTXT::ApplicationState, &onSnapApp);
         UI::uiSnap(uiTXT::Notepad, &onSnapNote);
         UI::uiHand(uiTXT::Notepad, &onHandNote);
         UI::uiSnap(uiTXT::ToggleConfigs, &onSnapOpt);
         UI::uiHand(uiTXT::ToggleConfigs, &onHandOpt);
+        UI::uiSnap(uiTXT::Latency, &onSnapLatency);
         CF::api();
       };
       static void uiSnap(uiTXT k, uiSnap_ cb) {
@@ -127,38 +190,288 @@ namespace K {
         else sess->cbMsg[(char)k] = cb;
       };
       static void uiSend(uiTXT k, json o, bool h = false) {
-        static unsigned long uiT_MKT = 0;
-        if (argHeadless) return;
-        uiSess *sess = (uiSess *) uiGroup->getUserData();
-        if (sess->u == 0) return;
-        if (k == uiTXT::MarketData) {
-          if (uiT_MKT+369 > FN::T()) return;
-          uiT_MKT = FN::T();
-        }
-        if (h) uiHold(k, o);
-        else uiUp(k, o);
+        if (uiAdmit(k)) uiPush(k, move(o), h);
+      };
+      template <typename T> static void uiSend(uiTXT k, const T &o, bool h = false) {
+        if (uiAdmit(k)) uiPush(k, uiJson(o, 0), h);
+      };
+      static void uiLevels() {
+        ++uiBook;
+        book();
       };
       static void delay(double delayUI) {
-        static unsigned int uiThread = 0;
+        static unsigned long uiTimer = 0;
         if (argHeadless) return;
         ui_delayUI = delayUI;
         wsMutex.lock();
         uiSess *sess = (uiSess *) uiGroup->getUserData();
         sess->D.clear();
         wsMutex.unlock();
-        thread([&]() {
-          unsigned int uiThread_ = ++uiThread;
-          double k = ui_delayUI;
-          int timeout = k ? (int)(k*1e+3) : 6e+4;
-          while (uiThread_ == uiThread) {
-            if (argDebugEvents) FN::log("DEBUG", "EV UI thread");
-            if (k) appPush();
-            else appState();
-            this_thread::sleep_for(chrono::milliseconds(timeout));
-          }
-        }).detach();
+        TM::cancel(uiTimer);
+        evEmpty k = delayUI ? &appPush : &appState;
+        k();
+        uiTimer = TM::every(delayUI ? delayUI * 1e+6 : 6e+7, [k]() {
+          if (argDebugEvents) FN::log("DEBUG", "EV UI timer");
+          k();
+        });
       };
     private:
+      friend class BM;
+      friend class UT;
+      static bool uiAdmit(uiTXT k) {
+        return !argHeadless and uiSubs[(unsigned char)k & 127];
+      };
+      static int rate(const char *k, size_t n) {
+        fnScan s(k, n);
+        double rate = -1;
+        if (!s.object([&](const char *k, size_t n) {
+          return fnScan::is(k, n, "rate") ? s.num(rate) : s.skip();
+        })) return -1;
+        return UI::rate(rate);
+      };
+      static int rate(const json &k) {
+        json::const_iterator it = k.find("rate");
+        return it != k.end() and it->is_number() ? rate(it->get<double>()) : -1;
+      };
+      static int rate(double k) { // clamped before the cast, out of range doubles have no int
+        return k >= -1 ? (int)min(k, 6e+4) : -1;
+      };
+      static void subscribe(uiConn *c, uiTXT k, int rate) {
+        lock_guard<mutex> lock(wsMutex);
+        if (!c) return;
+        unsigned char i = (unsigned char)k & 127;
+        if (!c->topics[i]) {
+          c->topics.set(i);
+          uiSubs[i]++;
+        }
+        if (k != uiTXT::MarketData) return;
+        if (rate >= 0) {
+          c->delta = true;
+          c->rate = min(rate, 60000);
+        }
+        c->bids.clear();
+        c->asks.clear();
+        c->book = 0;
+        c->seq = 0;
+        c->T = 0;
+      };
+      template <typename F> static auto uiJson(const F &fn, int) -> decltype(fn(), json()) {
+        return fn();
+      };
+      template <typename T> static json uiJson(const T &o, long) {
+        return o;
+      };
+      static void uiPush(uiTXT k, json o, bool h) {
+        if (h) uiHold(k, o);
+        else uiUp(k, move(o));
+      };
+      static string encode(string m, const json &o, bool binary) {
+        if (o.is_null()) return m;
+        if (!binary) return m.append(o.dump());
+        vector<uint8_t> v = json::to_msgpack(o);
+        return m.append(v.begin(), v.end());
+      };
+      static void broadcast(const vector<pair<uiTXT, json>> &k) {
+        typedef uWS::WebSocket<uWS::SERVER> uiWs;
+        map<pair<uintptr_t, vector<bool>>, uiWs::PreparedMessage*> prepared;
+        lock_guard<mutex> lock(wsMutex);
+        uiGroup->forEach([&](uiWs *ws) {
+          uiConn *c = (uiConn*)ws->getUserData();
+          if (!c) return;
+          vector<bool> topics;
+          bool any = false;
+          for (vector<pair<uiTXT, json>>::const_iterator it = k.begin(); it != k.end(); ++it) {
+            topics.push_back(c->topics[(unsigned char)it->first & 127]);
+            any |= topics.back();
+          }
+          if (!any) return;
+          if (c->queued > uiQueueMax) return close(ws);
+          pair<uintptr_t, vector<bool>> key(c->flags & (uiZ ? uiDeflate | uiMsgpack : uiMsgpack), topics);
+          uiWs::PreparedMessage *&m = prepared[key];
+          if (!m) m = prepare(k, topics, key.first & uiMsgpack, key.first & uiDeflate);
+          send(ws, c, m);
+        });
+        for (map<pair<uintptr_t, vector<bool>>, uiWs::PreparedMessage*>::iterator it = prepared.begin(); it != prepared.end(); ++it)
+          uiWs::finalizeMessage(it->second);
+      };
+      static void book() {
+        typedef uWS::WebSocket<uWS::SERVER> uiWs;
+        if (argHeadless or !uiSubs[(unsigned char)uiTXT::MarketData]) return;
+        uiWs::PreparedMessage *prepared[4] = {nullptr, nullptr, nullptr, nullptr};
+        json full;
+        unsigned long T = FN::T();
+        lock_guard<mutex> lock(wsMutex);
+        uiGroup->forEach([&](uiWs *ws) {
+          uiConn *c = (uiConn*)ws->getUserData();
+          if (!c or !c->topics[(unsigned char)uiTXT::MarketData] or c->book == uiBook
+            or c->T + c->rate > T or c->queued) return;
+          c->book = uiBook;
+          c->T = T;
+          uintptr_t f = c->flags & (uiZ ? uiDeflate | uiMsgpack : uiMsgpack);
+          if (!c->delta) {
+            if (full.is_null()) full = mLevels(levels(mgBook.levels(mSide::Bid)), levels(mgBook.levels(mSide::Ask)));
+            if (!prepared[f]) prepared[f] = prepare(vector<pair<uiTXT, json>>(1, pair<uiTXT, json>(uiTXT::MarketData, full)), vector<bool>(1, true), f & uiMsgpack, f & uiDeflate);
+            return send(ws, c, prepared[f]);
+          }
+          json o = {
+            {"seq", ++c->seq},
+            {"bids", diff(c->bids, mgBook.levels(mSide::Bid))},
+            {"asks", diff(c->asks, mgBook.levels(mSide::Ask))}
+          };
+          if (o["bids"].empty() and o["asks"].empty() and c->seq > 1) { --c->seq; return; }
+          if (c->seq > 1) o["delta"] = true;
+          uiWs::PreparedMessage *m = prepare(vector<pair<uiTXT, json>>(1, pair<uiTXT, json>(uiTXT::MarketData, o)), vector<bool>(1, true), f & uiMsgpack, f & uiDeflate);
+          send(ws, c, m);
+          uiWs::finalizeMessage(m);
+        });
+        for (unsigned int i = 0; i < 4; ++i)
+          if (prepared[i]) uiWs::finalizeMessage(prepared[i]);
+      };
+      static vector<mLevel> levels(const map<long, mLevel> &k) {
+        vector<mLevel> v;
+        for (map<long, mLevel>::const_iterator it = k.begin(); it != k.end(); ++it)
+          v.push_back(it->second);
+        return v;
+      };
+      static json diff(map<long, mLevel> &sent, const map<long, mLevel> &k) {
+        json o = json::array();
+        map<long, mLevel>::iterator a = sent.begin();
+        map<long, mLevel>::const_iterator b = k.begin();
+        while (a != sent.end() or b != k.end())
+          if (b == k.end() or (a != sent.end() and a->first < b->first)) {
+            o.push_back({{"price", a->second.price}, {"size", 0}});
+            ++a;
+          } else {
+            if (a == sent.end() or b->first < a->first or a->second.size != b->second.size)
+              o.push_back({{"price", b->second.price}, {"size", b->second.size}});
+            if (a != sent.end() and a->first == b->first) ++a;
+            ++b;
+          }
+        sent = k;
+        return o;
+      };
+      static void send(uWS::WebSocket<uWS::SERVER> *ws, uiConn *c, uWS::WebSocket<uWS::SERVER>::PreparedMessage *m) {
+        ++c->queued;
+        ws->sendPrepared(m, c);
+      };
+      static void sent(uWS::WebSocket<uWS::SERVER> *ws, void *data, bool cancelled, void *reserved) {
+        if (!cancelled) --((uiConn*)data)->queued;
+      };
+      static void close(uWS::WebSocket<uWS::SERVER> *ws) {
+        FN::logWar("UI", string("Closing a client with ") + to_string(((uiConn*)ws->getUserData())->queued) + " unsent batches, it will reconnect and start over");
+        uiClosing = true;
+        ws->close(1013);
+        uiClosing = false;
+      };
+      static uWS::WebSocket<uWS::SERVER>::PreparedMessage *prepare(const vector<pair<uiTXT, json>> &k, const vector<bool> &topics, bool binary, bool deflated) {
+        vector<string> m;
+        vector<int> none;
+        size_t length = 0;
+        for (size_t i = 0; i < k.size(); ++i) {
+          if (!topics[i]) continue;
+          m.push_back(encode(string(1, (char)uiBIT::MSG) + (char)k[i].first, k[i].second, binary));
+          length += m.back().length();
+        }
+        if (deflated and length >= 512)
+          for (vector<string>::iterator it = m.begin(); it != m.end(); ++it) *it = deflate(*it);
+        else deflated = false;
+        return uWS::WebSocket<uWS::SERVER>::prepareMessageBatch(m, none, binary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, deflated, &sent);
+      };
+      static bool contains(uWS::Header h, const string &k) {
+        return h and search(h.value, h.value + h.valueLength, k.begin(), k.end()) != h.value + h.valueLength;
+      };
+      static void files() {
+        static const string dir = FN::readlink("app/client").substr(3);
+        static const map<string, pair<string, bool>> types = {
+          {"html", {"text/html; charset=UTF-8", true}},
+          {"js", {"application/javascript; charset=UTF-8", true}},
+          {"css", {"text/css; charset=UTF-8", true}},
+          {"png", {"image/png", false}},
+          {"mp3", {"audio/mpeg", false}}
+        };
+        shared_ptr<map<string, uiFile>> cache = make_shared<map<string, uiFile>>();
+        vector<string> dirs(1, "");
+#ifdef __linux__
+        if (uiNotify == -1 and (uiNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) != -1)
+          TM::every(1e+6, &reload, false);
+#endif
+        for (size_t i = 0; i < dirs.size(); ++i) {
+          DIR *d = opendir((dir + dirs[i]).data());
+          if (!d) continue;
+#ifdef __linux__
+          if (uiNotify != -1) inotify_add_watch(uiNotify, (dir + dirs[i]).data(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+#endif
+          while (struct dirent *e = readdir(d)) {
+            string name = e->d_name;
+            if (name == "." or name == "..") continue;
+            string path = dirs[i] + "/" + name;
+            struct stat st;
+            if (stat((dir + path).data(), &st)) continue;
+            if (S_ISDIR(st.st_mode)) { dirs.push_back(path); continue; }
+            map<string, pair<string, bool>>::const_iterator type = types.find(name.substr(name.find_last_of('.') + 1));
+            if (type == types.end()) continue;
+            stringstream content;
+            content << ifstream(dir + path, ios::binary).rdbuf();
+            (*cache)[path] = file(content.str(), type->second.first, type->second.second);
+          }
+          closedir(d);
+        }
+        atomic_store(&uiFiles, shared_ptr<const map<string, uiFile>>(cache));
+      };
+      static void reload() {
+#ifdef __linux__
+        char buf[4096];
+        bool changed = false;
+        while (read(uiNotify, buf, sizeof(buf)) > 0) changed = true;
+        if (!changed) return;
+        files();
+        FN::log("UI", string("reloaded ") + to_string(atomic_load(&uiFiles)->size()) + " static files");
+#endif
+      };
+      static uiFile file(const string &k, const string &type, bool compress) {
+        uiFile f;
+        bool gzipped = k.length() > 1 and k[0] == '\x1f' and k[1] == '\x8b';
+        string plain = gzipped ? gzip(k, false) : k,
+               gz = gzipped ? k : (compress ? gzip(k, true) : "");
+        if (!gzipped and gz.length() >= plain.length()) gz = "";
+        stringstream etag;
+        etag << "W/\"" << hex << hash<string>()(gzipped ? gz : plain) << "\"";
+        f.etag = etag.str();
+        string head = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\nCache-Control: public, max-age=0\r\nETag: " + f.etag + "\r\nContent-Type: " + type + "\r\n";
+        if (!plain.empty() or !gzipped) f.plain = head + "Content-Length: " + to_string(plain.length()) + "\r\n\r\n" + plain;
+        if (!gz.empty()) f.gzip = head + "Content-Encoding: gzip\r\nContent-Length: " + to_string(gz.length()) + "\r\n\r\n" + gz;
+        f.notModified = "HTTP/1.1 304 Not Modified\r\nConnection: keep-alive\r\nVary: Accept-Encoding\r\nCache-Control: public, max-age=0\r\nETag: " + f.etag + "\r\n\r\n";
+        return f;
+      };
+      static string gzip(const string &k, bool compress) {
+        z_stream z = z_stream();
+        if ((compress ? deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, 31, 9, Z_DEFAULT_STRATEGY) : inflateInit2(&z, 31)) != Z_OK) return "";
+        string out;
+        char buf[16384];
+        int ret;
+        z.next_in = (Bytef*)k.data();
+        z.avail_in = k.length();
+        do {
+          z.next_out = (Bytef*)buf;
+          z.avail_out = sizeof(buf);
+          ret = compress ? ::deflate(&z, Z_FINISH) : inflate(&z, Z_NO_FLUSH);
+          out.append(buf, sizeof(buf) - z.avail_out);
+        } while (ret == Z_OK);
+        if (compress) deflateEnd(&z);
+        else inflateEnd(&z);
+        return ret == Z_STREAM_END ? out : "";
+      };
+      static string deflate(const string &k) {
+        string out(deflateBound(uiZ, k.length()) + 16, 0);
+        uiZ->next_in = (Bytef*)k.data();
+        uiZ->avail_in = k.length();
+        uiZ->next_out = (Bytef*)&out[0];
+        uiZ->avail_out = out.length();
+        ::deflate(uiZ, Z_SYNC_FLUSH);
+        out.resize(out.length() - uiZ->avail_out - 4); // drop the 00 00 ff ff flush marker, see RFC 7692
+        deflateReset(uiZ);
+        return out;
+      };
       static json onSnapApp() {
         return { serverState() };
       };
@@ -169,6 +482,9 @@ namespace K {
         if (!k.is_null() and k.size())
           uiNOTE = k.at(0);
       };
+      static json onSnapLatency() {
+        return MT::snapshot();
+      };
       static json onSnapOpt() {
         return { uiVisibleOpt };
       };
@@ -177,11 +493,8 @@ namespace K {
           uiVisibleOpt = k.at(0);
       };
       static void uiUp(uiTXT k, json o) {
-        string m(1, (char)uiBIT::MSG);
-        m += string(1, (char)k);
-        m += o.is_null() ? "" : o.dump();
-        lock_guard<mutex> lock(wsMutex);
-        uiGroup->broadcast(m.data(), m.length(), uWS::OpCode::TEXT);
+        vector<pair<uiTXT, json>> m(1, pair<uiTXT, json>(k, move(o)));
+        broadcast(m);
       };
       static void uiHold(uiTXT k, json o) {
         if (o.is_null()) {
@@ -243,9 +556,11 @@ namespace K {
           sess->D.erase(uiTXT::OrderStatusReports);
         }
         wsMutex.unlock();
+        vector<pair<uiTXT, json>> m;
         for (map<uiTXT, vector<json>>::iterator it_=msgs.begin(); it_!=msgs.end(); ++it_)
           for (vector<json>::iterator it = it_->second.begin(); it != it_->second.end(); ++it)
-            uiUp(it_->first, *it);
+            m.push_back(pair<uiTXT, json>(it_->first, move(*it)));
+        if (m.size()) broadcast(m);
         if (uiT_1m+60000 > FN::T()) return;
         uiT_1m = FN::T();
         appState();
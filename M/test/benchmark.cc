@@ -0,0 +1,232 @@
+#define K_BENCH
+#include "../src/server/K.h"
+
+static thread_local unsigned long bmAllocs = 0;
+void *operator new(size_t n, const nothrow_t&) noexcept {
+  ++bmAllocs;
+  return malloc(n ? n : 1);
+};
+void *operator new(size_t n) {
+  void *k = operator new(n, nothrow);
+  if (!k) throw bad_alloc();
+  return k;
+};
+void *operator new[](size_t n) { return operator new(n); };
+void *operator new[](size_t n, const nothrow_t&) noexcept { return operator new(n, nothrow); };
+void operator delete(void *k) noexcept { free(k); };
+void operator delete[](void *k) noexcept { free(k); };
+void operator delete(void *k, const nothrow_t&) noexcept { free(k); };
+void operator delete[](void *k, const nothrow_t&) noexcept { free(k); };
+void operator delete(void *k, size_t) noexcept { free(k); };
+void operator delete[](void *k, size_t) noexcept { free(k); };
+
+namespace K {
+  struct bmResult {
+           string name;
+    unsigned long ops;
+           double ns,
+                  allocs,
+                  p50,
+                  p90,
+                  p99,
+                  p999,
+                  max;
+  };
+  static json bmBaseline;
+  static vector<mLevels> bmLevels;
+  static string bmDepth;
+  static const char *bmModes[] = {
+    "Top", "Mid", "Join", "InverseJoin", "InverseTop",
+    "PingPong", "Boomerang", "AK47", "HamelinRat", "Depth"
+  };
+  class BM {
+    public:
+      static void main(int argc, char** argv) {
+        if (argc > 1) baseline(argv[1]);
+        streambuf *out = cout.rdbuf();
+        ofstream null("/dev/null");
+        cout.rdbuf(null.rdbuf());
+        setup();
+        run("noop", 1e+6, []() {});
+        levels(20);
+        run("MG::levelUp/20", 1e+5, []() { static unsigned int i = 0; MG::levelUp(bmLevels[++i % bmLevels.size()]); });
+        run("MG::filter/20", 1e+6, []() { MG::filter(); });
+        run("MG::calcFairValue/20", 1e+6, []() { MG::calcFairValue(); });
+        levels(200);
+        run("MG::levelUp/200", 1e+4, []() { static unsigned int i = 0; MG::levelUp(bmLevels[++i % bmLevels.size()]); });
+        run("MG::calcFairValue/200", 1e+6, []() { MG::calcFairValue(); });
+        levels(20);
+        for (unsigned int i = 0; i < 2400; ++i) MG::stdevPUp();
+        run("MG::calcStdev/1200", 1e+6, []() { MG::calcStdev(); });
+        run("MG::stdevPUp/1200", 1e+5, []() { MG::stdevPUp(); });
+        for (unsigned int i = 0; i < sizeof(bmModes) / sizeof(bmModes[0]); ++i) {
+          jsonQP["mode"] = i;
+          QP::compile();
+          run(string("QE::nextQuote/") + bmModes[i], 1e+5, []() { QE::nextQuote(); });
+        }
+        jsonQP["mode"] = (int)mQuotingMode::AK47;
+        QP::compile();
+        trades(5000);
+        run("PG::nextSafety/5000", 1e+3, []() { PG::nextSafety(); });
+        run("OG::toHistory/5000", 1e+4, []() {
+          static unsigned int i = 0;
+          ++i;
+          mOrder k(to_string(i), gw->exchange, mPair(gw->base, gw->quote), i % 2 ? mSide::Bid : mSide::Ask, 0.01, mOrderType::Limit, false, mgFairValue + (i % 2 ? -1 : 1) * (3 + i % 50), mTimeInForce::GTC, mORS::Complete, false);
+          k.lastQuantity = k.quantity;
+          OG::toHistory(k);
+        });
+        depth();
+        run("json::parse/depth20", 1e+5, []() {
+          json k = json::parse(bmDepth);
+          mLevels levels;
+          for (json::iterator it = k["bids"].begin(); it != k["bids"].end(); ++it)
+            levels.bids.push_back(mLevel(stod(it->at(0).get<string>()), stod(it->at(1).get<string>())));
+          for (json::iterator it = k["asks"].begin(); it != k["asks"].end(); ++it)
+            levels.asks.push_back(mLevel(stod(it->at(0).get<string>()), stod(it->at(1).get<string>())));
+        });
+        run("FN::book/depth20", 1e+5, []() {
+          mLevels levels;
+          FN::book(bmDepth.data(), bmDepth.length(), levels);
+        });
+        run("DB::insert", 1e+5, []() { DB::insert(uiTXT::Trades, tradesMemory.front(), false, tradesMemory.front().tradeId); });
+        DB::flush();
+        argHeadless = 0;
+        uiGroup->setUserData(new uiSess);
+        ((uiSess*)uiGroup->getUserData())->u = 1;
+        run("UI::uiSend", 1e+5, []() { UI::uiSend(uiTXT::Trades, tradesMemory.front()); });
+        run("UI::uiUp/levels", 1e+4, []() { UI::uiUp(uiTXT::MarketData, bmLevels.front()); });
+        argHeadless = 1;
+        cout.rdbuf(out);
+      };
+    private:
+      template <typename F> static void run(string name, unsigned long n, F fn) {
+        vector<unsigned long> T(n);
+        for (unsigned long i = 0; i < n / 10; ++i) fn();
+        unsigned long A = bmAllocs;
+        for (unsigned long i = 0; i < n; ++i) {
+          unsigned long t = FN::Tns();
+          fn();
+          T[i] = FN::Tns() - t;
+        }
+        A = bmAllocs - A;
+        double sum = 0;
+        for (vector<unsigned long>::iterator it = T.begin(); it != T.end(); ++it) sum += *it;
+        sort(T.begin(), T.end());
+        bmResult k = {name, n, sum / n, (double)A / n,
+          (double)T[n * 50 / 100], (double)T[n * 90 / 100], (double)T[n * 99 / 100], (double)T[n * 999 / 1000], (double)T.back()};
+        report(k);
+      };
+      static void report(const bmResult &k) {
+        json j = {
+          {"bench", k.name},
+          {"ops", k.ops},
+          {"ns_op", k.ns},
+          {"allocs_op", k.allocs},
+          {"p50", k.p50},
+          {"p90", k.p90},
+          {"p99", k.p99},
+          {"p999", k.p999},
+          {"max", k.max}
+        };
+        printf("%s\n", j.dump().data());
+        fflush(stdout);
+        stringstream ss;
+        ss << setprecision(1) << fixed
+          << left << setw(28) << k.name << right
+          << setw(12) << k.ns << " ns/op"
+          << setw(8) << k.allocs << " allocs/op"
+          << "  p50 " << setw(9) << k.p50
+          << "  p99 " << setw(9) << k.p99
+          << "  p999 " << setw(10) << k.p999;
+        if (bmBaseline.find(k.name) != bmBaseline.end() and bmBaseline[k.name].value("ns_op", 0.0))
+          ss << "  " << showpos << (k.ns / bmBaseline[k.name].value("ns_op", 0.0) - 1) * 1e+2 << "%" << noshowpos;
+        cerr << ss.str() << '\n';
+      };
+      static void baseline(string file) {
+        ifstream f(file);
+        if (!f.is_open()) { cerr << "Unable to read baseline " << file << '\n'; exit(EXIT_FAILURE); }
+        string line;
+        while (getline(f, line))
+          if (line.length() and line[0] == '{') {
+            json k = json::parse(line);
+            bmBaseline[k.value("bench", "")] = k;
+          }
+      };
+      static void setup() {
+        argHeadless = 1;
+        argNaked = 1;
+        argExchange = "SIM";
+        argTarget = "SIM";
+        argCurrency = "BTC/EUR";
+        argDatabase = ":memory:";
+        ev_gwConnectButton = ev_gwConnectOrder = ev_gwConnectMarket = ev_gwConnectExchange = [](mConnectivity k) {};
+        ev_ogOrder = [](mOrder k) {};
+        ev_ogTrade = [](mTrade k) {};
+        ev_mgLevels = ev_mgEwmaQuoteProtection = ev_mgTargetPosition = ev_pgTargetBasePosition = ev_uiQuotingParameters = ev_pgPosition = []() {};
+        CF::api();
+        DB::main();
+        QP::main();
+        OG::main();
+        MG::main();
+        PG::main();
+        QE::load();
+        ev_mgTargetPosition = []() {};
+        levels(20);
+        ev_gwDataWallet(mWallet(1, 0, gw->base));
+        ev_gwDataWallet(mWallet(1e+3, 0, gw->quote));
+        PG::calcTargetBasePos();
+        PG::calcSafety();
+      };
+      static void levels(unsigned int depth) {
+        mt19937 random(depth);
+        uniform_real_distribution<double> size(0.01, 2);
+        bmLevels.clear();
+        for (unsigned int i = 0; i < 64; ++i) {
+          mLevels k;
+          double mid = 1e+3 + gw->minTick * (i / 8 % 2);
+          for (unsigned int j = 0; j < depth; ++j) {
+            k.bids.push_back(mLevel(FN::roundNearest(mid - gw->minTick * (j + 1), gw->minTick), size(random)));
+            k.asks.push_back(mLevel(FN::roundNearest(mid + gw->minTick * (j + 1), gw->minTick), size(random)));
+          }
+          bmLevels.push_back(k);
+        }
+        MG::levelUp(bmLevels.front());
+      };
+      static void depth() {
+        auto decimal = [](double k) -> string {
+          stringstream ss;
+          ss << setprecision(8) << fixed << k;
+          return ss.str();
+        };
+        json k = {{"timestamp", FN::T() / 1000}, {"bids", json::array()}, {"asks", json::array()}};
+        for (vector<mLevel>::iterator it = bmLevels.front().bids.begin(); it != bmLevels.front().bids.end(); ++it)
+          k["bids"].push_back({decimal(it->price), decimal(it->size)});
+        for (vector<mLevel>::iterator it = bmLevels.front().asks.begin(); it != bmLevels.front().asks.end(); ++it)
+          k["asks"].push_back({decimal(it->price), decimal(it->size)});
+        bmDepth = k.dump();
+        mLevels levels;
+        if (!FN::book(bmDepth.data(), bmDepth.length(), levels)
+          or levels.bids.size() != bmLevels.front().bids.size()
+          or fabs(levels.bids.front().size - bmLevels.front().bids.front().size) > 1e-8
+        ) { cerr << "FN::book disagrees with json::parse" << '\n'; exit(EXIT_FAILURE); }
+      };
+      static void trades(unsigned int n) {
+        mt19937 random(n);
+        uniform_real_distribution<double> price(-50, 50),
+                                          qty(0.001, 0.1);
+        tradesMemory.clear();
+        for (unsigned int i = 0; i < n; ++i) {
+          mTrade k(to_string(i), gw->exchange, mPair(gw->base, gw->quote),
+            FN::roundNearest(mgFairValue + price(random), gw->minTick), qty(random),
+            i % 2 ? mSide::Bid : mSide::Ask, FN::T(), 0, 0, 0, 0, 0, 0, 0, false);
+          k.value = k.price * k.quantity;
+          tradesMemory.push_back(k);
+        }
+      };
+  };
+}
+
+int main(int argc, char** argv) {
+  K::BM::main(argc, argv);
+  return EXIT_SUCCESS;
+};
@@ -0,0 +1,325 @@
+#include "../src/server/K.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace K {
+  class UT {
+    public:
+      static int main() {
+        check("mRollingStat/two-pass", &rollingStat);
+        check("JN/record-replay", &journal);
+        check("EN/ring-reuse", &rings);
+        check("GwPeatio/stand-in", &peatio);
+        check("UI/subscribe-rate", &subscribeRate);
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+      };
+    private:
+      static unsigned int failed;
+      static void check(string name, string (*fn)()) {
+        string k = fn();
+        cerr << left << setw(28) << name << (k.empty() ? "ok" : "FAILED: " + k) << '\n';
+        if (!k.empty()) ++failed;
+      };
+      static string str(double k) {
+        stringstream ss;
+        ss << setprecision(17) << k;
+        return ss.str();
+      };
+      static double stdev(const vector<double> &a, double *mean) { // the full recompute mRollingStat replaced
+        int n = a.size();
+        if (n == 0) return 0.0;
+        double sum = 0;
+        for (int i = 0; i < n; ++i) sum += a[i];
+        *mean = sum / n;
+        double sq_diff_sum = 0;
+        for (int i = 0; i < n; ++i) {
+          double diff = a[i] - *mean;
+          sq_diff_sum += diff * diff;
+        }
+        return sqrt(sq_diff_sum / n);
+      };
+      static string rollingStat() {
+        mt19937 random(42);
+        normal_distribution<double> step(0, .5);
+        mRollingStat k;
+        vector<double> a;
+        size_t periods = 120;
+        double price = 6e+4, // a high price with small steps is where a sliding variance drifts the most
+               error = 0;
+        k.resize(periods);
+        for (unsigned int i = 0; i < 1e+5; ++i) {
+          if (i == 3e+4) periods = 60;  // shrink mid-run, keeps the newest samples
+          if (i == 6e+4) periods = 240; // grow again, refills from the current window
+          k.resize(periods);
+          price += step(random);
+          a.push_back(price);
+          if (a.size() > periods) a.erase(a.begin(), a.end() - periods);
+          k.push_back(price);
+          double mean,
+                 sd = stdev(a, &mean);
+          if (k.size() != a.size())
+            return "size " + to_string(k.size()) + " != " + to_string(a.size()) + " at sample " + to_string(i);
+          if (fabs(k.mean - mean) > 1e-9 * fabs(mean))
+            return "mean " + str(k.mean) + " != " + str(mean) + " at sample " + to_string(i);
+          if (a.size() > 1) error = max(error, fabs(k.stdev() - sd) / sd);
+          if (error > 1e-8)
+            return "stdev drifted by " + str(error) + " at sample " + to_string(i);
+        }
+        return "";
+      };
+      static void ignore(mLevels) {};
+      static void ignore(mSide, mLevel, unsigned long) {};
+      static void ignore(mTrade) {};
+      static void ignore(mOrder) {};
+      static void ignore(mWallet) {};
+      static string journal() {
+        string file = "/tmp/K-units-" + to_string(getpid()) + ".jn";
+        gw = new GwSim();
+        gw->base = "BTC";
+        gw->quote = "EUR";
+        gw->minTick = 0.01;
+        gw->minSize = 0.001;
+        ev_gwDataLevels = &ignore;
+        ev_gwDataLevel = &ignore;
+        ev_gwDataTrade = &ignore;
+        ev_gwDataOrder = &ignore;
+        ev_gwDataWallet = &ignore;
+        argRecord = file;
+        JN::main();
+        argRecord = "";
+        FN::T(1500000000000);
+        ev_gwDataLevels(mLevels({mLevel(999.5, 2), mLevel(999, 3)}, {mLevel(1000.5, 1)}));
+        FN::T(1500000000250);
+        ev_gwDataLevel(mSide::Ask, mLevel(1001, 0.5), 42);
+        ev_gwDataTrade(mTrade(1000.5, 0.25, mSide::Bid));
+        mOrder o("K-1", "ex-77", mORS::Working, 999.5, 2, 0.5);
+        o.side = mSide::Bid;
+        ev_gwDataOrder(o);
+        ev_gwDataWallet(mWallet(3.5, 0.5, "BTC"));
+        JN::flush();
+        jnFile.close();
+        argReplay = file;
+        GwReplay k;
+        static unsigned long fired = 0;
+        TM::once(5e+5, []() { fired = FN::T(); });
+        TM::replay(1500000000499);
+        if (fired) return "timer fired early at " + to_string(fired);
+        TM::replay(1500000000500);
+        if (fired != 1500000000500) return "timer fired at " + to_string(fired) + " instead of on the journal clock";
+        FN::T(1500000000000);
+        argReplay = "";
+        unlink(file.data());
+        if (k.base != "BTC" or k.quote != "EUR" or k.minTick != 0.01 or k.minSize != 0.001)
+          return "header " + k.base + "/" + k.quote + " " + str(k.minTick) + " " + str(k.minSize);
+        if (FN::T() != 1500000000000) return "clock " + to_string(FN::T()) + " is not at the first record";
+        jnRecord r;
+        if (!k.read(r) or r.type != 'L' or r.T != 1500000000000 or r.levels.bids.size() != 2 or r.levels.asks.size() != 1
+          or r.levels.bids[1].price != 999 or r.levels.bids[1].size != 3 or r.levels.asks[0].price != 1000.5)
+          return "levels record";
+        if (!k.read(r) or r.type != 'l' or r.T != 1500000000250 or r.side != mSide::Ask
+          or r.level.price != 1001 or r.level.size != 0.5 or r.seq != 42)
+          return "level record";
+        if (!k.read(r) or r.type != 't' or r.trade.side != mSide::Bid or r.trade.price != 1000.5 or r.trade.quantity != 0.25)
+          return "trade record";
+        if (!k.read(r) or r.type != 'o' or r.order.orderId != "K-1" or r.order.exchangeId != "ex-77" or r.order.orderStatus != mORS::Working
+          or r.order.side != mSide::Bid or r.order.price != 999.5 or r.order.quantity != 2 or r.order.lastQuantity != 0.5)
+          return "order record";
+        if (!k.read(r) or r.type != 'w' or r.wallet.currency != "BTC" or r.wallet.amount != 3.5 or r.wallet.held != 0.5)
+          return "wallet record";
+        if (k.read(r)) return "unexpected record after the last one";
+        return "";
+      };
+      static string rings() {
+        for (unsigned int i = 0; i < enRingsMax * 4; ++i)
+          thread([]() { enOwner.r = EN::ring(); }).join();
+        if (enRingsN != 1) return to_string(enRingsN) + " rings for threads that never overlapped";
+        vector<thread> k;
+        atomic<unsigned int> missed(0);
+        mutex m;
+        m.lock();
+        for (unsigned int i = 0; i < enRingsMax + 8; ++i)
+          k.push_back(thread([&]() {
+            if (!(enOwner.r = EN::ring())) ++missed;
+            lock_guard<mutex> lock(m);
+          }));
+        while (enRingsN + missed < enRingsMax + 8) this_thread::yield();
+        m.unlock();
+        for (vector<thread>::iterator it = k.begin(); it != k.end(); ++it) it->join();
+        if (enRingsN != enRingsMax or missed != 8)
+          return to_string(enRingsN) + " rings and " + to_string(missed) + " threads left without one";
+        return "";
+      };
+      static string subscribeRate() {
+        const char *text[] = {"{\"rate\":1e20}", "{\"rate\":-1e20}", "{\"rate\":250}", "{\"rate\":-7}", "{}"};
+        int textRate[] = {60000, -1, 250, -1, -1};
+        for (unsigned int i = 0; i < 5; ++i)
+          if (UI::rate(text[i], strlen(text[i])) != textRate[i])
+            return string("text ") + text[i] + " gave " + to_string(UI::rate(text[i], strlen(text[i])));
+        double binary[] = {1e20, -1e20, 250.9, -0.5};
+        int binaryRate[] = {60000, -1, 250, 0};
+        for (unsigned int i = 0; i < 4; ++i) {
+          json k;
+          k["rate"] = binary[i];
+          if (UI::rate(json::from_msgpack(json::to_msgpack(k))) != binaryRate[i])
+            return "msgpack " + str(binary[i]) + " gave " + to_string(UI::rate(binary[i]));
+        }
+        if (UI::rate(numeric_limits<double>::quiet_NaN()) != -1 or UI::rate(numeric_limits<double>::infinity()) != 60000
+          or UI::rate(-numeric_limits<double>::infinity()) != -1)
+          return "non finite rates were not clamped";
+        return "";
+      };
+      static map<string, string> routes;
+      static vector<string> hits;
+      static mutex standInMutex;
+      static int standIn(unsigned short *port) { // a local HTTP server that answers from routes, one request per connection
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in a;
+        memset(&a, 0, sizeof(a));
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t n = sizeof(a);
+        if (fd < 0 or ::bind(fd, (sockaddr*)&a, n) or listen(fd, 16) or getsockname(fd, (sockaddr*)&a, &n)) return -1;
+        *port = ntohs(a.sin_port);
+        thread([fd]() {
+          int c;
+          while ((c = accept(fd, nullptr, nullptr)) >= 0) {
+            string req;
+            char buf[4096];
+            ssize_t r;
+            while (req.find("\r\n\r\n") == string::npos and (r = recv(c, buf, sizeof(buf), 0)) > 0) req.append(buf, r);
+            size_t head = req.find("\r\n\r\n"),
+                   length = req.find("Content-Length: ");
+            length = length < head ? stoul(req.substr(length + 16)) : 0;
+            while (head != string::npos and req.length() < head + 4 + length and (r = recv(c, buf, sizeof(buf), 0)) > 0) req.append(buf, r);
+            string line = req.substr(0, req.find("\r\n")),
+                   method = line.substr(0, line.find(' ')),
+                   url = line.substr(method.length() + 1, line.rfind(' ') - method.length() - 1),
+                   path = url.substr(0, url.find('?')),
+                   body;
+            {
+              lock_guard<mutex> lock(standInMutex);
+              hits.push_back(method + " " + url + (head != string::npos ? " " + req.substr(head + 4) : ""));
+              body = routes[method + " " + path];
+            }
+            string res = string(body.empty() ? "HTTP/1.1 404 Not Found" : "HTTP/1.1 200 OK")
+              + "\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: " + to_string(body.length()) + "\r\n\r\n" + body;
+            send(c, res.data(), res.length(), MSG_NOSIGNAL);
+            close(c);
+          }
+        }).detach();
+        return fd;
+      };
+      static void route(string k, string body) {
+        lock_guard<mutex> lock(standInMutex);
+        routes[k] = body;
+      };
+      static string hit(string k) {
+        lock_guard<mutex> lock(standInMutex);
+        for (vector<string>::reverse_iterator it = hits.rbegin(); it != hits.rend(); ++it)
+          if (it->find(k) == 0) return *it;
+        return "";
+      };
+      static mConnectivity orderEntry;
+      static vector<mWallet> wallets;
+      static vector<mOrder> orders;
+      static string peatio() {
+        unsigned short port;
+        int fd = standIn(&port);
+        if (fd < 0) return "unable to start the stand-in server";
+        route("GET /api/v2/markets", "[{\"id\":\"ltceur\",\"name\":\"LTC/EUR\",\"price_precision\":3,\"amount_precision\":2,\"min_amount\":\"0.1\"},"
+          "{\"id\":\"btceur\",\"name\":\"BTC/EUR\",\"bid_precision\":2,\"ask_precision\":3,\"min_ask_amount\":\"0.0005\",\"min_bid_amount\":\"0.002\"}]");
+        route("GET /api/v2/members/me", "{\"accounts\":[{\"currency\":\"btc\",\"balance\":\"1.5\",\"locked\":\"0.25\"},"
+          "{\"currency\":\"eur\",\"balance\":\"1000.0\",\"locked\":\"0.0\"},{\"currency\":\"ltc\",\"balance\":\"9.0\",\"locked\":\"0.0\"}]}");
+        route("POST /api/v2/orders", "{\"id\":7,\"side\":\"buy\",\"ord_type\":\"limit\",\"price\":\"999.5\",\"state\":\"wait\",\"volume\":\"0.5\",\"executed_volume\":\"0.0\"}");
+        ev_gwConnectOrder = [](mConnectivity k) {
+          lock_guard<mutex> lock(standInMutex);
+          orderEntry = k;
+        };
+        ev_gwDataWallet = [](mWallet k) {
+          lock_guard<mutex> lock(standInMutex);
+          wallets.push_back(k);
+        };
+        ev_gwDataOrder = [](mOrder k) {
+          lock_guard<mutex> lock(standInMutex);
+          orders.push_back(k);
+        };
+        gw = new GwPeatio();
+        gw->name = "peatio";
+        gw->base = "BTC";
+        gw->quote = "EUR";
+        gw->apikey = "key";
+        gw->secret = "secret";
+        gw->http = "http://127.0.0.1:" + to_string(port);
+        gw->config();
+        CF::cfExchange(mExchange::Peatio);
+        string err;
+        if (fabs(gw->minTick - 0.01) > 1e-12 or fabs(gw->minSize - 0.002) > 1e-12)
+          err = "minTick " + str(gw->minTick) + " and minSize " + str(gw->minSize) + " were not read from /api/v2/markets";
+        if (err.empty()) {
+          gw->wallet();
+          lock_guard<mutex> lock(standInMutex);
+          string k = hits.empty() ? "" : hits.back();
+          if (k.find("GET /api/v2/members/me?") != 0 or k.find("access_key=key") == string::npos
+            or k.find("tonce=") == string::npos or k.find("signature=") == string::npos)
+            err = "unsigned wallet request: " + k;
+          else if (orderEntry != mConnectivity::Connected)
+            err = "order entry is not connected after an authorized wallet reply";
+          else if (wallets.size() != 2 or wallets[0].currency != "BTC" or wallets[0].amount != 1.5 or wallets[0].held != 0.25 or wallets[1].currency != "EUR")
+            err = "wallets were not read from /api/v2/members/me";
+        }
+        if (err.empty()) {
+          gw->send("K-1", mSide::Bid, 999.5, 0.5, mOrderType::Limit, mTimeInForce::GTC, false, 0);
+          for (unsigned int i = 0; i < 500; ++i) {
+            {
+              lock_guard<mutex> lock(standInMutex);
+              if (!orders.empty()) break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(10));
+          }
+          string k = hit("POST /api/v2/orders");
+          lock_guard<mutex> lock(standInMutex);
+          if (k.find("market=btceur") == string::npos or k.find("price=999.50000000") == string::npos
+            or k.find("side=buy") == string::npos or k.find("volume=0.50000000") == string::npos)
+            err = "order request: " + k;
+          else if (orders.empty() or orders[0].orderId != "K-1" or orders[0].exchangeId != "7" or orders[0].orderStatus != mORS::Working)
+            err = "order reply was not reported as working";
+        }
+        if (err.empty()) {
+          route("GET /api/v2/orders", "[]");
+          route("GET /api/v2/order", "{\"id\":7,\"side\":\"buy\",\"ord_type\":\"limit\",\"price\":\"999.5\",\"state\":\"done\",\"volume\":\"0.5\",\"executed_volume\":\"0.5\"}");
+          ((GwPeatio*)gw)->orders();
+          string k = hit("GET /api/v2/order?");
+          lock_guard<mutex> lock(standInMutex);
+          if (orderEntry != mConnectivity::Connected)
+            err = "order entry is not connected after an empty list of open orders";
+          else if (k.find("id=7") == string::npos)
+            err = "the order missing from the open orders was not looked up: " + k;
+          else if (orders.size() != 2 or orders[1].exchangeId != "7" or orders[1].orderStatus != mORS::Complete or orders[1].lastQuantity != 0.5)
+            err = "the fill of the order missing from the open orders was not reported";
+        }
+        if (err.empty()) {
+          route("GET /api/v2/members/me", "{\"error\":{\"code\":2001,\"message\":\"Authorization failed\"}}");
+          gw->wallet();
+          lock_guard<mutex> lock(standInMutex);
+          if (orderEntry != mConnectivity::Disconnected)
+            err = "order entry is still connected after an unauthorized wallet reply";
+        }
+        gw->freeSockets();
+        shutdown(fd, SHUT_RDWR);
+        close(fd);
+        return err;
+      };
+  };
+  unsigned int UT::failed = 0;
+  map<string, string> UT::routes;
+  vector<string> UT::hits;
+  mutex UT::standInMutex;
+  mConnectivity UT::orderEntry = mConnectivity::Disconnected;
+  vector<mWallet> UT::wallets;
+  vector<mOrder> UT::orders;
+}
+
+int main() {
+  return K::UT::main();
+};